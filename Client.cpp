@@ -3,7 +3,6 @@
 //
 
 #include "Client.h"
-#include "Commands.h"
 #include "ShutdownTasks.h"
 #include <arpa/inet.h>
 
@@ -56,8 +55,12 @@ namespace {
             case LibSocket::SocketReceiveError::INVALID_ARG: return rv + "invalid argument passed.";
             case LibSocket::SocketReceiveError::NO_MEMORY: return rv + "no memory available.";
             case LibSocket::SocketReceiveError::NOT_CONNECTED: return rv + "not connected.";
+            case LibSocket::SocketReceiveError::CONNECTION_RESET: return rv + "connection reset by server.";
+            case LibSocket::SocketReceiveError::TIMED_OUT: return rv + "connection timed out.";
             case LibSocket::SocketReceiveError::NOT_A_SOCKET: return rv + "not a socket.";
             case LibSocket::SocketReceiveError::DISCONNECTING: return "[WARNING]: socket disconnecting.";
+            case LibSocket::SocketReceiveError::MESSAGE_TOO_LARGE: return rv + "message over the size limit.";
+            case LibSocket::SocketReceiveError::HEARTBEAT: return "";
             case LibSocket::SocketReceiveError::SUCCESS: return "";
         }
     }
@@ -73,6 +76,10 @@ namespace ClientServerChatApp {
         return std::thread{Client::run_client, this};
     }
 
+    void Client::send_request(const Protocol::Request& request) {
+        full_send(binary ? Protocol::encode_binary(request) : Protocol::to_text(request), {});
+    }
+
     void Client::run_client(Client* client) {
         // define create handlers
         client->create_handlers[LibSocket::SocketCreateError::SUCCESS] = [&] {
@@ -82,7 +89,7 @@ namespace ClientServerChatApp {
             client->sync_socket_created.resolve(false);
             client->console->push_message(create_err_msg(err));
             ShutdownTasks::instance().execute();
-            client->console->refresh_text.resolve(true);
+            client->console->refresh();
         };
         // define connect handlers
         client->connect_handlers[LibSocket::SocketConnectError::SUCCESS] = [&] {
@@ -97,12 +104,20 @@ namespace ClientServerChatApp {
         // Try to connect to server
         std::function<void(const std::string&, Socket*)> recv_success_handler = [&](const std::string& payload, Socket* socket) {
             if (payload.empty()) return;
-            if (payload == MessageSignals::SRV_FULL()) {
-                client->console->push_message("[WARNING]: Server is full. Exiting.");
-                ShutdownTasks::instance().execute();
-                return;
+            auto reply = Protocol::read_reply(payload, client->binary);
+            switch (reply.opcode) {
+                case Protocol::Opcode::FULL:
+                    client->console->push_message("[WARNING]: Server is full. Exiting.");
+                    ShutdownTasks::instance().execute();
+                    return;
+                case Protocol::Opcode::TOO_SLOW:
+                    client->console->push_message("[WARNING]: Disconnected for falling too far behind. Exiting.");
+                    ShutdownTasks::instance().execute();
+                    return;
+                default:
+                    if (!reply.text.empty()) client->console->push_message(reply.text);
+                    return;
             }
-            client->console->push_message(payload);
         };
         client->receive_handlers[LibSocket::SocketReceiveError::SUCCESS] = recv_success_handler;
         client->receive_handlers[LibSocket::SocketReceiveError::DISCONNECTING] = [&](const std::string& _payload_, Socket* socket) {
@@ -113,7 +128,16 @@ namespace ClientServerChatApp {
             client->console->push_message(receive_err_msg(err));
             ShutdownTasks::instance().execute();
         };
-        for (auto err: LibSocket::all_send_errors) client->send_handlers[err] = [&] (const std::string& payload) {
+        client->receive_handlers[LibSocket::SocketReceiveError::MESSAGE_TOO_LARGE] = [&] (const std::string& payload, Socket* socket) {
+            client->console->push_message(receive_err_msg(LibSocket::SocketReceiveError::MESSAGE_TOO_LARGE));
+            ShutdownTasks::instance().execute();
+        };
+        // the server pings connections that have gone quiet, answering keeps an idle client from being dropped.
+        // the sender thread does the writing so the reply can't land in the middle of another frame
+        client->receive_handlers[LibSocket::SocketReceiveError::HEARTBEAT] = [&] (const std::string& payload, Socket* socket) {
+            client->send_buffer.tx("");
+        };
+        for (auto err: LibSocket::all_send_errors) client->send_handlers[err] = [&] (std::string_view payload) {
             client->console->push_message("[WARNING]: Message failed to send");
         };
         client->create(LibSocket::SocketFamily::INET, LibSocket::Type::STREAM);
@@ -124,9 +148,18 @@ namespace ClientServerChatApp {
         auto addr = client->sync_addr.retrieve();
         client->connect((sockaddr*)&addr, sizeof addr);
         if (client->console->shutdown.load()) return;
+        // offer the binary protocol, a server that doesn't know it answers with a text error and text is kept
+        client->receive_handlers[LibSocket::SocketReceiveError::SUCCESS] = [&](const std::string& payload, Socket* socket) {
+            if (payload == Protocol::encode_binary(Protocol::Welcome{})) client->binary = true;
+            else if (Protocol::read_reply(payload, false).opcode == Protocol::Opcode::FULL) recv_success_handler(payload, socket);
+        };
+        client->full_send(Protocol::hello(), {});
+        client->receive_str({});
+        client->receive_handlers[LibSocket::SocketReceiveError::SUCCESS] = recv_success_handler;
+        if (client->console->shutdown.load()) return;
         // Initiate message loop
         auto username = client->sync_username.retrieve();
-        client->full_send("$register " + username, {});
+        client->send_request({Protocol::Opcode::REGISTER, username});
         auto res = client->receive_str({});
         if (client->console->shutdown.load()) {
             client->sync_registered.resolve(false);
@@ -139,7 +172,8 @@ namespace ClientServerChatApp {
                 client->console->input_hooks.set_active(1, false);
                 client->console->render_hooks.set_active(1, true);
                 client->console->render_hooks.set_active(0, true);
-                client->console->refresh_text.resolve(true);
+                // the log was printed over the window
+                client->console->repaint();
                 client->receive_handlers[LibSocket::SocketReceiveError::SUCCESS] = recv_success_handler;
             }
             }, 1);
@@ -147,7 +181,12 @@ namespace ClientServerChatApp {
         std::thread sender{[&] {
             while (!client->console->shutdown.load()) {
                 std::string payload = client->send_buffer.rx();
-                if (payload.starts_with(Commands::GET_LOG()) || payload.starts_with(Commands::GET_LIST())) {
+                if (payload.empty()) {
+                    client->send_heartbeat({});
+                    continue;
+                }
+                auto request = Protocol::parse_command(payload);
+                if (request.opcode == Protocol::Opcode::GET_LOG || request.opcode == Protocol::Opcode::GET_LIST) {
                     // disable normal hooks
                     client->console->input_hooks.set_active(0, false);
                     client->console->render_hooks.set_active(1, false);
@@ -159,17 +198,18 @@ namespace ClientServerChatApp {
                     // every new message received will get shoved right into the alternate buffer
 
                     client->receive_handlers[LibSocket::SocketReceiveError::SUCCESS] = [&](const std::string& payload, Socket*){
-                        if (payload == MessageSignals::SRV_DONE_SEND()) {
+                        auto reply = Protocol::read_reply(payload, client->binary);
+                        if (reply.opcode == Protocol::Opcode::DONE_SEND) {
                             client->receive_handlers[LibSocket::SocketReceiveError::SUCCESS] = recv_success_handler;
                             std::cout << "Press q to return";
                             return;
                         }
-                        if (!payload.empty()) std::cout << payload << '\n';
+                        if (!reply.text.empty()) std::cout << reply.text << '\n';
                     };
-                    client->full_send(payload, {});
+                    client->send_request(request);
                     continue;
                 }
-                client->full_send(payload, {});
+                client->send_request(request);
             }
         }};
         Utilities::DeferExec defer_sender_cleanup{[&] {sender.join();}};
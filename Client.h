@@ -6,6 +6,7 @@
 #define CLIENTSERVERCHATAPP_CLIENT_H
 
 #include "Console.h"
+#include "Protocol.h"
 
 namespace ClientServerChatApp {
     /**
@@ -15,6 +16,13 @@ namespace ClientServerChatApp {
     private:
         static void run_client(Client* client);
         Socket upd_socket;
+        /// The server accepted the binary protocol, set once before registering
+        bool binary{false};
+        /**
+         * Sends a request in the protocol negotiated with the server
+         * @param request what to send
+         */
+        void send_request(const Protocol::Request& request);
     public:
         SmartConsole::Console* console;
         SyncPoint<sockaddr_in> sync_addr;
@@ -30,8 +38,8 @@ namespace ClientServerChatApp {
         SyncPoint<bool> sync_socket_created;
         /// Child thread sends Socket connection successful, main receives it
         SyncPoint<bool> sync_socket_established;
-        /// Ring buffer for outgoing messages
-        Utilities::RingBuffer<std::string> send_buffer;
+        /// Ring buffer for outgoing messages, fed by the main thread and heartbeat replies from the client thread
+        Utilities::MpscRing<std::string, 256> send_buffer;
         explicit Client(SmartConsole::Console* _console);
         /**
          * Initialize client on separate thread
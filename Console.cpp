@@ -123,8 +123,8 @@ void SmartConsole::ReadKey(char *output) {
 
 char *SmartConsole::ReadLine() {
     // went a different route for chat app
-    char* output = new char[SocketMaxMessageSize()];
-    std::cin.getline(output, SocketMaxMessageSize());
+    char* output = new char[ConsoleInputBufferSize()];
+    std::cin.getline(output, ConsoleInputBufferSize());
     std::cin.clear();
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     return output;
@@ -206,9 +206,135 @@ void SmartConsole::InitializeTerminal() {
 #endif
 #pragma endregion
 
+namespace {
+    /// Unchanged cells present writes again rather than moving the cursor over them, a move is at least 3 bytes
+    constexpr int max_rewritten_gap = 3;
+
+    void append_number(std::string& out, int n) {
+        char digits[16];
+        auto end = std::to_chars(digits, digits + sizeof digits, n).ptr;
+        out.append(digits, end);
+    }
+}
+
 namespace SmartConsole {
+#pragma region ScreenBuffer::
+    void ScreenBuffer::resize(int width, int height) {
+        if (width == _width && height == _height) return;
+        _width = std::max(width, 0);
+        _height = std::max(height, 0);
+        _back.assign((size_t)_width * _height, Cell{});
+        _front.assign((size_t)_width * _height, Cell{});
+        _repaint = true;
+    }
+
+    void ScreenBuffer::clear() {
+        std::fill(_back.begin(), _back.end(), Cell{});
+    }
+
+    void ScreenBuffer::put(int x, int y, char glyph, Style style) {
+        if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+        _back[(size_t)y * _width + x] = {glyph, style};
+    }
+
+    void ScreenBuffer::fill(int x, int y, int count, char glyph, Style style) {
+        if (y < 0 || y >= _height) return;
+        for (int end = std::min(x + count, _width), i = std::max(x, 0); i < end; ++i) {
+            _back[(size_t)y * _width + i] = {glyph, style};
+        }
+    }
+
+    void ScreenBuffer::write(int x, int y, std::string_view text, Style style, int end) {
+        if (end < 0 || end > _width) end = _width;
+        for (auto c : text) {
+            if (x >= end) break;
+            // anything else would move the cursor or take more than one cell, and the cells would no longer
+            // match the terminal
+            put(x++, y, c >= ' ' && c <= '~' ? c : '?', style);
+        }
+    }
+
+    void ScreenBuffer::present(std::string& out, int cursor_x, int cursor_y) {
+        // whoever wrote to the terminal last left it at the default colors and ASCII, present does too
+        Style pen{};
+        // where the cursor is, -1 when it's not known: at first and after writing a row's last column, which
+        // terminals handle differently
+        int at_x = -1;
+        int at_y = -1;
+        if (_repaint) {
+            out += "\x1b[0m\x1b(B\x1b[2J";
+            std::fill(_front.begin(), _front.end(), Cell{});
+            _repaint = false;
+        }
+        auto move_to = [&](int x, int y) {
+            if (x == at_x && y == at_y) return;
+            out += "\x1b[";
+            if (y == at_y && at_x != -1 && x > at_x) {
+                // forward along the row
+                if (x - at_x > 1) append_number(out, x - at_x);
+                out += 'C';
+            } else if (y == at_y && at_x != -1) {
+                // back along the row
+                append_number(out, x + 1);
+                out += 'G';
+            } else {
+                append_number(out, y + 1);
+                if (x > 0) {
+                    out += ';';
+                    append_number(out, x + 1);
+                }
+                out += 'H';
+            }
+            at_x = x;
+            at_y = y;
+        };
+        auto set_style = [&](const Style& style) {
+            if (style.line_draw != pen.line_draw) out += style.line_draw ? "\x1b(0" : "\x1b(B";
+            if (style.fg != pen.fg || style.bg != pen.bg) {
+                if (style.fg == FGColor::Default && style.bg == BGColor::Default) {
+                    out += "\x1b[0m";
+                } else {
+                    out += "\x1b[";
+                    if (style.fg != pen.fg) append_number(out, (int)style.fg);
+                    if (style.fg != pen.fg && style.bg != pen.bg) out += ';';
+                    if (style.bg != pen.bg) append_number(out, (int)style.bg);
+                    out += 'm';
+                }
+            }
+            pen = style;
+        };
+        for (int y = 0; y < _height; ++y) {
+            auto back = &_back[(size_t)y * _width];
+            auto front = &_front[(size_t)y * _width];
+            auto emit = [&](int x) {
+                set_style(back[x].style);
+                out += back[x].glyph;
+                at_x = x + 1 < _width ? x + 1 : -1;
+            };
+            int x = 0;
+            while (x < _width) {
+                if (back[x] == front[x]) {
+                    ++x;
+                    continue;
+                }
+                move_to(x, y);
+                while (true) {
+                    while (x < _width && back[x] != front[x]) emit(x++);
+                    // a short gap in the current style costs less written out than skipped
+                    int gap = x;
+                    while (gap < _width && gap - x < max_rewritten_gap && back[gap] == front[gap] && back[gap].style == pen) ++gap;
+                    if (gap == _width || back[gap] == front[gap]) break;
+                    while (x < gap) emit(x++);
+                }
+            }
+        }
+        std::copy(_back.begin(), _back.end(), _front.begin());
+        set_style({});
+        move_to(std::clamp(cursor_x, 0, std::max(_width - 1, 0)), std::clamp(cursor_y, 0, std::max(_height - 1, 0)));
+    }
+#pragma endregion
     Console::Console(std::string commands) {
-        memset(buffer, 0, SocketMaxMessageSize());
+        memset(buffer, 0, ConsoleInputBufferSize());
         _commands = commands;
     }
 #pragma region Console::
@@ -230,7 +356,8 @@ namespace SmartConsole {
     void Console::update_console_size() {
         // reads stdin file descriptor to get the size of the terminal
         struct ttysize ts;
-        ioctl(STDIN_FILENO, TIOCGSIZE, &ts);
+        // not a terminal, keep the last size rather than whatever is in ts
+        if (ioctl(STDIN_FILENO, TIOCGSIZE, &ts) == -1) return;
         auto width = ts.ts_cols;
         auto height = ts.ts_lines;
         if (width != console_width() || height != console_height()) {
@@ -245,86 +372,43 @@ namespace SmartConsole {
 #pragma endregion
 #pragma region DrawMethods
     void Console::draw_title() {
-        // find center
-        size_t center_x = console_width() / 2;
-        // find left-most column
-        size_t left = center_x - title_width() / 2;
-        // loop through rows
-        for (size_t y = 0; y < title_height(); y++) {
-            // loop through columns
-            for (size_t x = 0; x < title_width(); x++) {
-                // Set cursor to left-most column of current row
-                SetCursorPosition(ss, left + x, y);
-                // first print the graphics rendition, then actual char of title
-                ss << title_mask()[y][x] << title()[y][x];
-            }
+        auto rows = title();
+        // find left-most column, centered
+        int left = console_width() / 2 - (int)title_width() / 2 - 1;
+        // the title's first row always ended up under its second, both landed on the terminal's first row, so
+        // the layout starts with the second
+        for (size_t y = 1; y < rows.size(); y++) {
+            screen.write(left, (int)y - 1, rows[y], {.fg = FGColor::Green});
         }
-        // Clear graphics rendition so next phase of rendering doesn't have incorrect colors
-        SmartConsole::ResetFormat(ss);
     }
 
     void Console::draw_message_window() {
-        // Move cursor to top-left corner of where window will be printed
-        SmartConsole::SetCursorPosition(ss, 0, (int)title_height());
-        SmartConsole::SetCharacterSet(ss, SmartConsole::CharacterSet::LineDraw); // draw lines
-        // ┌─░
-        ss << SmartConsole::Line::CTL << SmartConsole::Line::HRL;
-        SmartConsole::SetCharacterSet(ss, SmartConsole::CharacterSet::ASCII); // back to ASCII
-        // ┌─ Messages ░
-        ss << " Messages ";
-        SmartConsole::SetCharacterSet(ss, SmartConsole::CharacterSet::LineDraw); // back to lines
-        // ┌─ Messages ───────────░
-        for (int i = 0; i < console_width() - 13; i++) {
-            ss << SmartConsole::Line::HRL;
-        }
-        // ┌─ Messages ───────────┐
-        // ░
-        ss << SmartConsole::Line::CTR;
+        int top = (int)title_height() - 1;
+        int bottom = console_height() - 3;
+        int right = console_width() - 1;
+        Style lines{.line_draw = true};
         // ┌─ Messages ───────────┐
+        screen.put(0, top, Line::CTL, lines);
+        screen.put(1, top, Line::HRL, lines);
+        screen.write(2, top, " Messages ");
+        screen.fill(12, top, right - 12, Line::HRL, lines);
+        screen.put(right, top, Line::CTR, lines);
         // │                      │
         // │                      │
-        // ░
-        for (int i = 0; i < std::max((int)(console_height() - title_height() - 3), 0); ++i) {
-            ss << SmartConsole::Line::VTL << "\x1b[" << console_width() << 'G' << SmartConsole::Line::VTL;
+        for (int y = top + 1; y < bottom; ++y) {
+            screen.put(0, y, Line::VTL, lines);
+            screen.put(right, y, Line::VTL, lines);
         }
-        // ┌─ Messages ───────────┐
-        // │                      │
-        // │                      │
-        // └░
-        ss << SmartConsole::Line::CBL;
-        // ┌─ Messages ───────────┐
-        // │                      │
-        // │                      │
-        // └──────────────────────░
-        for (int i = 0; i < console_width()-2; ++i) {
-            ss << SmartConsole::Line::HRL;
-        }
-        // ┌─ Messages ───────────┐
-        // │                      │
-        // │                      │
-        // └──────────────────────┘
-        // ░
-        ss << SmartConsole::Line::CBR;
-        SmartConsole::SetCharacterSet(ss, SmartConsole::CharacterSet::ASCII);
-        SmartConsole::SetFGColor(ss, SmartConsole::FGColor::BrightBlue);
-        // ┌─ Messages ───────────┐
-        // │                      │
-        // │                      │
         // └──────────────────────┘
+        screen.put(0, bottom, Line::CBL, lines);
+        screen.fill(1, bottom, right - 1, Line::HRL, lines);
+        screen.put(right, bottom, Line::CBR, lines);
         // ~~ Commands: $exit, etc.
-        // ░
-        ss << "~~ Commands: " << _commands;
-        SmartConsole::ResetFormat(ss);
+        screen.write(0, bottom + 1, "~~ Commands: " + _commands, {.fg = FGColor::BrightBlue});
     }
 
     void Console::draw_messages() {
         int scroll_pos = _message_window_scroll_position.load();
-        // ┌─ Messages ───────────┐
-        // │░                     │
-        // │                      │
-        // └──────────────────────┘
-        // ~~ Commands: $exit, etc.
-        SmartConsole::SetCursorPosition(ss, 3, (int)title_height() + 1);
         int message_window_height = msg_window_size();
         // ┌─ Messages ───────────┐
         // │<user>: Ayyy          │
@@ -332,16 +416,18 @@ namespace SmartConsole {
         // └──────────────────────┘
         // ~~ Commands: $exit, etc.
         for (int i = 0; i < message_window_height; ++i) {
-            if (i + scroll_pos > messages.size()) break;
-            if (messages[i + scroll_pos].starts_with("[INFO]:")) {
-                SmartConsole::SetFGColor(ss, SmartConsole::FGColor::BrightBlue);
-            } else if (messages[i + scroll_pos].starts_with("[WARNING]:")) {
-                SmartConsole::SetFGColor(ss, SmartConsole::FGColor::BrightYellow);
-            } else if (messages[i + scroll_pos].starts_with("[ERROR]:")) {
-                SmartConsole::SetFGColor(ss, SmartConsole::FGColor::BrightRed);
+            if (i + scroll_pos >= (int)messages.size()) break;
+            const auto& message = messages[i + scroll_pos];
+            Style style;
+            if (message.starts_with("[INFO]:")) {
+                style.fg = FGColor::BrightBlue;
+            } else if (message.starts_with("[WARNING]:")) {
+                style.fg = FGColor::BrightYellow;
+            } else if (message.starts_with("[ERROR]:")) {
+                style.fg = FGColor::BrightRed;
             }
-            ss << messages[i + scroll_pos] << "\x1b[1B\x1b[3G";
-            SmartConsole::ResetFormat(ss);
+            // cut off before the scroll bar
+            screen.write(2, (int)title_height() + i, message, style, console_width() - 2);
         }
     }
 
@@ -349,10 +435,12 @@ namespace SmartConsole {
         int msg_win_height = msg_window_size()-2;
         int scroll_pos = _message_window_scroll_position.load();
         int max_scroll_pos = std::max((int)messages.size() - msg_win_height, 0);
-        int bar_height = (int)((float) msg_win_height - (float)msg_win_height * ((float)max_scroll_pos / (float)messages.size()));
-        int top_of_msg_win = (int)title_height()+2;
-        int top_of_bar = (int)std::lerp((float)(top_of_msg_win), (float)(top_of_msg_win + msg_win_height - bar_height), (float)scroll_pos / ((float)max_scroll_pos));
-        SmartConsole::SetBGColor(ss, SmartConsole::BGColor::BrightBlack);
+        int bar_height = messages.empty() ? msg_win_height
+            : (int)((float) msg_win_height - (float)msg_win_height * ((float)max_scroll_pos / (float)messages.size()));
+        int top_of_msg_win = (int)title_height()+1;
+        float scrolled = max_scroll_pos == 0 ? 0.0f : std::clamp((float)scroll_pos / (float)max_scroll_pos, 0.0f, 1.0f);
+        int top_of_bar = (int)std::lerp((float)(top_of_msg_win), (float)(top_of_msg_win + msg_win_height - bar_height), scrolled);
+        int column = console_width()-2;
         // ┌─ Messages ───────────┐
         // │<user>: Ayyy          │
         // │<user>: :)           ░│
@@ -361,8 +449,7 @@ namespace SmartConsole {
         // │<user>: :)            │
         // └──────────────────────┘
         for(int i = 0; i < bar_height; ++i) {
-            SmartConsole::SetCursorPosition(ss, console_width()-1, top_of_bar + i);
-            ss << ' ';
+            screen.put(column, top_of_bar + i, ' ', {.bg = BGColor::BrightBlack});
         }
         // ┌─ Messages ───────────┐
         // │<user>: Ayyy         ◆│
@@ -371,25 +458,29 @@ namespace SmartConsole {
         // │<user>: :)           ░│
         // │<user>: :)           ◆│
         // └──────────────────────┘
-        SmartConsole::SetCharacterSet(ss, SmartConsole::CharacterSet::LineDraw);
-        SmartConsole::SetCursorPosition(ss, console_width()-1, top_of_msg_win-1);
-        ss << (char)96;
-        SmartConsole::SetCursorPosition(ss, console_width()-1, console_height()-3);
-        ss << (char)96;
-        SmartConsole::SetCharacterSet(ss, SmartConsole::CharacterSet::ASCII);
-        SmartConsole::ResetFormat(ss);
+        Style diamond{.bg = BGColor::BrightBlack, .line_draw = true};
+        screen.put(column, top_of_msg_win-1, (char)96, diamond);
+        screen.put(column, console_height()-4, (char)96, diamond);
     }
 
-
     void Console::draw_input_buffer() {
-        SmartConsole::SetCursorPosition(ss, 0, console_height()-1);
-        std::cout << "$ " << buffer;
+        // > whatever user has already typed░
+        screen.put(0, screen.height()-1, '>', {.fg = FGColor::Green});
+        screen.write(2, screen.height()-1, buffer);
+    }
+
+    void Console::draw_stats() {
+        auto requests = _render_requests.load();
+        std::string stats = "frames " + std::to_string(_frames)
+            + "  skipped " + std::to_string(requests > _frames ? requests - _frames : 0)
+            + "  render " + std::to_string(_render_time.count()) + "us";
+        // right end of the commands row
+        screen.write(screen.width() - (int)stats.size(), screen.height() - 2, stats, {.fg = FGColor::BrightBlack});
     }
 
     void Console::clear_message_window() {
-        for (auto i = title_height()+1; i < console_height() - title_height() - 3; ++i) {
-            SmartConsole::SetCursorPosition(ss, 2, i);
-            ss << "\x1b[" << console_width() - 2 << "X";
+        for (int i = 0; i < msg_window_size(); ++i) {
+            screen.fill(1, (int)title_height() + i, console_width() - 2, ' ');
         }
     }
 #pragma endregion
@@ -412,7 +503,7 @@ namespace SmartConsole {
                 if (console->console_width() != window_width || console->console_height() != window_height) {
                     window_width = console->console_width();
                     window_height = console->console_height();
-                    console->refresh_text.resolve(true);
+                    console->refresh();
                 }
                 std::this_thread::sleep_for(std::chrono::seconds(1));
             }
@@ -421,10 +512,13 @@ namespace SmartConsole {
             console->shutdown.store(true);
         });
         ClientServerChatApp::ShutdownTasks::instance().push_task([&] {
-            console->refresh_text.resolve(true);
+            console->refresh();
         });
         console->render_hooks.push([&](Console* c) {
-            SmartConsole::Clear(c->ss);
+            c->screen.resize(c->console_width(), c->console_height());
+            // the size changed or something else drew over the window
+            if (c->_refresh_layout.exchange(false)) c->screen.invalidate();
+            c->screen.clear();
         });
         console->render_hooks.push([&](Console* c) {
             c->draw_title();
@@ -436,34 +530,37 @@ namespace SmartConsole {
             c->draw_scroll_bar();
             c->draw_messages();
             c->messages_mtx.unlock();
-
-            // ┌─ Messages ───────────┐
-            // │<user>: Ayyy          │
-            // │<user>: :)            │
-            // └──────────────────────┘
-            // ~~ Commands: $exit, etc.
-            // ░
-            SmartConsole::SetCursorPosition(console->ss, 1, console->console_height());
             // ┌─ Messages ───────────┐
             // │<user>: Ayyy          │
             // │<user>: :)            │
             // └──────────────────────┘
             // ~~ Commands: $exit, etc.
             // > whatever user has already typed░
-            SmartConsole::SetFGColor(console->ss, SmartConsole::FGColor::Green);
-            console->ss << ">\x1b[" << strlen(console->buffer) << "C";
-            // Clear graphics rendition
-            SmartConsole::ResetFormat(console->ss);
+            c->draw_input_buffer();
+            if (c->show_stats) c->draw_stats();
+            c->screen.present(c->frame, 2 + (int)strlen(c->buffer), c->screen.height() - 1);
             }, 1);
         while(!console->shutdown.load()) {
-            console->render_hooks.execute(console);
-            // Now that the string stream is full of all the chars I want to insert into the
-            // terminal screen, insert all of it at once and flush the buffer
-            std::cout << console->ss.str() << std::flush;
-            // Get a fresh stringstream so previous work isn't repeated
-            console->ss = std::stringstream{};
+            auto start = std::chrono::steady_clock::now();
+            {
+                UniqueLock lock{console->screen_mtx};
+                console->render_hooks.execute(console);
+                // Now that the frame holds everything that changed on the terminal screen,
+                // insert all of it at once and flush the buffer
+                if (!console->frame.empty()) {
+                    std::cout.write(console->frame.data(), (std::streamsize)console->frame.size()) << std::flush;
+                    console->frame.clear();
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+            console->_frames++;
+            console->_render_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
             // Wait for more input
             console->refresh_text.retrieve();
+            // a burst of messages gets a frame every frame_interval instead of one each
+            std::this_thread::sleep_until(start + console->frame_interval);
+            // whatever asked for a frame in the meantime is drawn by the next one
+            console->refresh_text.try_retrieve();
         }
         window_size_checker.join();
     }
@@ -487,9 +584,9 @@ namespace SmartConsole {
                     // reset buffer position to zero
                     console->buff_position = 0;
                     // zero out char buffer
-                    memset(console->buffer, 0, SocketMaxMessageSize());
+                    memset(console->buffer, 0, ConsoleInputBufferSize());
                 }
-            } else if (buff[0] >= ' ' && buff[0] <= '~') { // if char is a displayable ASCII character
+            } else if (buff[0] >= ' ' && buff[0] <= '~' && console->buff_position < ConsoleInputBufferSize() - 1) { // if char is a displayable ASCII character and there's room left
                 // copy temp buffer to the end of console buffer and increment position
                 strcpy(console->buffer + (console->buff_position++), buff);
             } else if (strcmp(buff, "\x1b[A") == 0) { // up arrow
@@ -500,7 +597,7 @@ namespace SmartConsole {
                     // subtract 1 from scroll position
                     atomic_fetch_sub(&console->_message_window_scroll_position, 1);
                     // tell renderer to refresh screen
-                    console->refresh_text.resolve(true);
+                    console->refresh();
                 }
             } else if (strcmp(buff, "\x1b[B") == 0 && !console->_message_window_autoscroll.load()) { // down arrow
                 // if already at the bottom, do nothing
@@ -511,7 +608,7 @@ namespace SmartConsole {
                 // if the position will display the latest message, turn on autoscroll
                 if (pos == end) console->_message_window_autoscroll.store(true);
                 // tell renderer to refresh screen
-                console->refresh_text.resolve(true);
+                console->refresh();
             }
         });
         // only one char is ever captured, but keep extra available just incase.
@@ -535,9 +632,8 @@ namespace SmartConsole {
 
             console->input_hooks.execute(buff);
 
-            // TODO: Make sure this isn't competing with renderer
-            SmartConsole::ResetFormat(std::cout);
-            std::cout << "\x1b[" << console->console_height() << ";3H\x1b[" << console->console_width() << "P" << console->buffer << std::flush;
+            // typing shouldn't have to wait for the next frame
+            console->echo_input();
         }
     }
 
@@ -545,10 +641,31 @@ namespace SmartConsole {
         return std::thread{run_input_capture, this};
     }
 
+    void Console::refresh() {
+        _render_requests.fetch_add(1, std::memory_order_relaxed);
+        refresh_text.resolve(true);
+    }
+
+    void Console::echo_input() {
+        UniqueLock lock{screen_mtx};
+        // nothing's been drawn yet, the first frame shows it
+        if (screen.height() == 0) return;
+        screen.fill(0, screen.height() - 1, screen.width(), ' ');
+        draw_input_buffer();
+        screen.present(frame, 2 + (int)strlen(buffer), screen.height() - 1);
+        std::cout.write(frame.data(), (std::streamsize)frame.size()) << std::flush;
+        frame.clear();
+    }
+
+    void Console::repaint() {
+        _refresh_layout.store(true);
+        refresh();
+    }
+
     void Console::push_message(const std::string &message) {
         UniqueLock lock{messages_mtx};
         messages.push_back(message);
-        refresh_text.resolve(true);
+        refresh();
     }
 
 #pragma endregion
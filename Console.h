@@ -122,23 +122,63 @@ namespace SmartConsole {
         size_t group;
         bool active;
         ConsoleHookFunction<T> hook;
-        Hook(ConsoleHookFunction<T> _hook): hook(std::move(_hook)), group{0}, active{true} {
+        Hook(ConsoleHookFunction<T> _hook): Hook(std::move(_hook), 0) {}
+        Hook(ConsoleHookFunction<T> _hook, size_t _group): hook{std::move(_hook)}, group{_group}, active{true} {
             static std::atomic<size_t> _id{0}; // always a unique id :-)
             id = std::atomic_fetch_add(&_id, 1); // fetch and increment
         }
-        Hook(ConsoleHookFunction<T> _hook, size_t _group): hook{std::move(_hook)}, group{_group}, active{true} {}
     };
+    /**
+     * Functions run in order of their group whenever the console has something for them
+     * @details Hooks change a handful of times per session but run on every keystroke and every frame, so the
+     * changes do the work: each one builds a new snapshot of the active hooks, sorted by group, and swaps it in.
+     * execute just walks the snapshot it finds, without a lock and without allocating, and a hook may change the
+     * hooks while they're running, the change applies from the next execute. A replaced snapshot is freed by the
+     * next change that finds no execute in progress.
+     * @tparam T parameter the hooks get
+     */
     template<typename T>
     class ConsoleHooks {
     private:
+        /// What execute walks, never changed once it's published
+        struct Snapshot {
+            std::vector<ConsoleHookFunction<T>> functions;
+        };
+        /// Every hook in the order they were pushed, guarded by mtx
         std::vector<Hook<T>> hooks;
         std::mutex mtx;
+        /// The active hooks sorted by group, nullptr until the first push
+        std::atomic<const Snapshot*> current{nullptr};
+        /// Calls to execute in progress
+        std::atomic<size_t> readers{0};
+        /// Replaced snapshots an execute may still be walking, guarded by mtx
+        std::vector<std::unique_ptr<const Snapshot>> retired;
+
+        /// Swaps in a snapshot of hooks, mtx must be held
+        void publish() {
+            auto sorted = hooks;
+            // hooks in the same group keep running in the order they were pushed
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Hook<T>& l, const Hook<T>& r) {return l.group < r.group;});
+            auto snapshot = std::make_unique<Snapshot>();
+            for (auto& h : sorted) {
+                if (h.active) snapshot->functions.push_back(std::move(h.hook));
+            }
+            retired.emplace_back(current.exchange(snapshot.release()));
+            // an execute that starts after this sees the new snapshot, so with none running the old ones can go
+            if (readers.load() == 0) retired.clear();
+        }
     public:
-        ConsoleHooks(): hooks{}, mtx{} {}
+        ConsoleHooks() = default;
+        ~ConsoleHooks() {
+            delete current.load();
+        }
+        ConsoleHooks(const ConsoleHooks&) = delete;
+        ConsoleHooks& operator=(const ConsoleHooks&) = delete;
         size_t push(const ConsoleHookFunction<T>& hook, size_t group = 0) {
             Hook nHook{hook, group};
             UniqueLock lock{mtx};
-            hooks.push_back(nHook);
+            hooks.push_back(std::move(nHook));
+            publish();
             return hooks[hooks.size()-1].id;
         }
         void erase(size_t with_id) {
@@ -146,38 +186,104 @@ namespace SmartConsole {
             for (size_t i = 0; i < hooks.size(); ++i) {
                 if (hooks[i].id == with_id) {
                     hooks.erase(hooks.begin() + i);
+                    publish();
                     return;
                 }
             }
         }
         void erase_group(size_t group) {
-//            UniqueLock lock{mtx};
-            for (size_t i = 0; i < hooks.size(); ++i) {
-                if (hooks[i].group == group) {
-                    hooks.erase(hooks.begin() + i);
-                    i--;
-                }
-            }
+            UniqueLock lock{mtx};
+            auto erased = std::erase_if(hooks, [group](const Hook<T>& h) {return h.group == group;});
+            if (erased > 0) publish();
         }
         void set_active(size_t group, bool to) {
-//            UniqueLock lock{mtx};
+            UniqueLock lock{mtx};
+            bool changed = false;
             for(auto& hook : hooks) {
-                if (hook.group == group) hook.active = to;
+                if (hook.group == group && hook.active != to) {
+                    hook.active = to;
+                    changed = true;
+                }
             }
+            if (changed) publish();
         }
         void execute(T param) {
-//            UniqueLock lock{mtx};
-            // sort by group
-            std::sort(hooks.begin(), hooks.end(), [](Hook<T>& l, Hook<T>& r) {return l.group < r.group;});
-            std::vector<Hook<T>> cpy = hooks;
-//            lock.unlock();
-            for (const auto& h : cpy) {
-                if (!h.active) continue;
-                h.hook(param); // execute in that order
+            // counted before looking at current, so a change either sees this running or this sees the change
+            readers.fetch_add(1);
+            Utilities::DeferExec defer_release{[this] {readers.fetch_sub(1);}};
+            auto snapshot = current.load();
+            if (snapshot == nullptr) return;
+            for (const auto& hook : snapshot->functions) {
+                hook(param); // execute in that order
             }
         }
     };
 
+    /**
+     * How a cell is drawn
+     */
+    struct Style {
+        FGColor fg{FGColor::Default};
+        BGColor bg{BGColor::Default};
+        /// Glyph is from the line drawing character set, one of Line::
+        bool line_draw{false};
+        bool operator==(const Style&) const = default;
+    };
+    /**
+     * One character on the terminal
+     */
+    struct Cell {
+        char glyph{' '};
+        Style style{};
+        bool operator==(const Cell&) const = default;
+    };
+
+    /**
+     * Grid of terminal cells that only sends the terminal what changed.
+     * @details Frames are drawn into the back buffer, present compares it to the front buffer (what the terminal
+     * shows) and writes just the cells that differ, moving the cursor only across the gaps between them and
+     * switching colors and character set only when they change. A new chat line then costs about the line
+     * itself instead of a full screen. A resize or invalidate makes the next present repaint everything.
+     * Not thread safe, only the renderer uses it.
+     */
+    class ScreenBuffer {
+    private:
+        int _width{0};
+        int _height{0};
+        /// Frame being drawn
+        std::vector<Cell> _back;
+        /// What the terminal shows
+        std::vector<Cell> _front;
+        /// Front doesn't match the terminal, the next present clears the screen first
+        bool _repaint{true};
+    public:
+        /// Changes the size, clears both buffers if it's different
+        void resize(int width, int height);
+        int width() const { return _width; }
+        int height() const { return _height; }
+        /// Forget what the terminal shows so the next present repaints everything
+        void invalidate() { _repaint = true; }
+        /// Blanks the back buffer, for drawing a frame from scratch
+        void clear();
+        /// Sets a cell of the back buffer, anything off screen is ignored
+        void put(int x, int y, char glyph, Style style = {});
+        /// Sets count cells of a row to the same glyph
+        void fill(int x, int y, int count, char glyph, Style style = {});
+        /**
+         * Writes text into a row, non-printable characters show as '?'
+         * @param end column the text is cut off at, the row's end if negative
+         */
+        void write(int x, int y, std::string_view text, Style style = {}, int end = -1);
+        /**
+         * Appends the escape sequences that bring the terminal from the front to the back buffer, which then
+         * becomes the front. Colors and character set are left at their defaults
+         * @param out appended to
+         * @param cursor_x where the cursor is left, 0 based
+         * @param cursor_y
+         */
+        void present(std::string& out, int cursor_x, int cursor_y);
+    };
+
     /**
      * Class responsible for managing standard input and output
      */
@@ -202,6 +308,15 @@ namespace SmartConsole {
         /// Triggers layout refresh
         std::atomic<bool> _refresh_layout{false};
 #pragma endregion
+#pragma region RenderStats
+    private:
+        /// Calls to refresh, most are folded into a frame drawn for another one
+        std::atomic<uint64_t> _render_requests{0};
+        /// Frames drawn, renderer only
+        uint64_t _frames{0};
+        /// How long the last frame took to draw and write out, renderer only
+        std::chrono::microseconds _render_time{0};
+#pragma endregion
 #pragma region StoredProperties
     public:
 
@@ -212,6 +327,14 @@ namespace SmartConsole {
 
         /// Easy-peasy 1-1 sync to refresh the text
         SyncPoint<bool> refresh_text;
+        /// Shortest time between two frames, whatever changes in between is drawn by the next one
+        std::chrono::microseconds frame_interval{1'000'000 / 60};
+        /// Show frames drawn, refreshes folded into them and render time on the commands row
+        bool show_stats{false};
+        /// Asks the renderer for a new frame, it comes at most every frame_interval
+        void refresh();
+        /// Shows what the user has typed right away instead of with the next frame
+        void echo_input();
 
         /// Mutex for the messages vector
         /// TODO: Decide if this is still necessary
@@ -224,6 +347,8 @@ namespace SmartConsole {
         /// Vector of messages that get printed to the screen
         std::vector<std::string> messages;
         void push_message(const std::string& message);
+        /// Redraws the whole window, for when something else has drawn over it
+        void repaint();
 
         /// Mutex for input buffer
         /// TODO: Most likely not necessary and should be removed
@@ -233,18 +358,22 @@ namespace SmartConsole {
         /// TODO: Most likely not necessary and should be removed
         std::condition_variable stdin_buff_cv;
         /// Standard Input Buffer used by input capture thread
-        char buffer[SocketMaxMessageSize()];
+        char buffer[ConsoleInputBufferSize()];
 
         /// Position of the cursor for user input at any given time
         size_t buff_position{0};
 
         /// Ring buffer
-        /// When this promise gets resolved it sends user input to the main thread to be processed
-        Utilities::RingBuffer<std::string> ring_buffer;
+        /// Sends user input to the main thread to be processed, fed by the input thread and shutdown tasks
+        Utilities::MpscRing<std::string, 256> ring_buffer;
 
-        /// String stream for generating the console window
-        /// using this rather than std::cout so the whole screen buffer can be generated before sending to stdout
-        std::stringstream ss;
+        /// Cells of the console window, render hooks draw the next frame into it
+        ScreenBuffer screen;
+        /// Escape sequences for the next frame, built in full before going to stdout so the cursor doesn't jump
+        /// around, kept so its capacity is reused
+        std::string frame;
+        /// Guards screen and frame, the renderer and the input echo both draw
+        std::mutex screen_mtx;
 
         ConsoleHooks<Console*> render_hooks;
         ConsoleHooks<char*> input_hooks;
@@ -332,9 +461,10 @@ namespace SmartConsole {
         void draw_messages();
         /// Draw the scroll bar on the right side of the message window
         void draw_scroll_bar();
-        /// Draw the input buffer at the bottom of the screen
-        /// TODO: Probably remove this one
+        /// Draw the prompt and what the user has typed at the bottom of the screen
         void draw_input_buffer();
+        /// Draw frame stats at the right end of the commands row
+        void draw_stats();
         /// Clear Message Window
         /// TODO: Probably remove this one
         void clear_message_window();
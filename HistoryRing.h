@@ -0,0 +1,54 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_HISTORYRING_H
+#define CLIENTSERVERCHATAPP_HISTORYRING_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Utilities {
+    /**
+     * The last capacity items pushed, oldest first.
+     * @details Items sit in one contiguous array that's allocated once, a push into a full ring overwrites the
+     * oldest item in place, so keeping the history costs no allocation and reading it back walks memory in order.
+     * Not thread safe.
+     * @tparam T stored item, has to be move assignable
+     */
+    template<typename T>
+    class HistoryRing {
+    private:
+        std::vector<T> _items;
+        size_t _capacity;
+        /// Slot of the oldest item once the ring is full, where the next push goes
+        size_t _next{0};
+    public:
+        /// @param capacity items kept, 0 keeps nothing
+        explicit HistoryRing(size_t capacity = 0): _capacity(capacity) { _items.reserve(capacity); }
+        void push(T item) {
+            if (_capacity == 0) return;
+            if (_items.size() < _capacity) {
+                _items.push_back(std::move(item));
+                return;
+            }
+            _items[_next] = std::move(item);
+            if (++_next == _capacity) _next = 0;
+        }
+        /**
+         * Walks the items, oldest first
+         * @param visit called with every item
+         */
+        template<typename Visit>
+        void for_each(Visit&& visit) const {
+            for (size_t i = _next; i < _items.size(); ++i) visit(_items[i]);
+            for (size_t i = 0; i < _next; ++i) visit(_items[i]);
+        }
+        size_t size() const { return _items.size(); }
+        size_t capacity() const { return _capacity; }
+        bool empty() const { return _items.empty(); }
+    };
+} // Utilities
+
+#endif //CLIENTSERVERCHATAPP_HISTORYRING_H
@@ -0,0 +1,92 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#include "LogView.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Utilities {
+    LogView::Mapping::~Mapping() {
+        ::munmap((void*)_data, _length);
+    }
+
+    std::shared_ptr<const LogView::Mapping> LogView::map(const std::string& path, size_t size) {
+        if (size == 0) return nullptr;
+        UniqueLock lock{_mtx};
+        if (path != _path) {
+            _path = path;
+            _mapping.reset();
+            _checkpoints = {0};
+            _indexed_bytes = 0;
+            _indexed_lines = 0;
+        }
+        if (_mapping != nullptr && _mapping->length() >= size) return _mapping;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) return nullptr;
+        // leave room to grow so a busy log isn't remapped on every request, the pages past the end of the file
+        // are never touched
+        auto length = size + size / 2;
+        auto data = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) return nullptr;
+        _mapping = std::make_shared<const Mapping>((const char*)data, length);
+        return _mapping;
+    }
+
+    void LogView::extend(const Mapping& mapping, size_t size) {
+        auto data = mapping.data();
+        auto position = _indexed_bytes;
+        while (position < size) {
+            auto newline = (const char*)std::memchr(data + position, '\n', size - position);
+            if (newline == nullptr) break;
+            position = newline - data + 1;
+            if (++_indexed_lines % index_stride == 0) _checkpoints.push_back(position);
+        }
+        _indexed_bytes = std::max(_indexed_bytes, position);
+    }
+
+    size_t LogView::line_offset(const Mapping& mapping, size_t line, size_t limit) const {
+        size_t position = _checkpoints[line / index_stride];
+        for (size_t i = 0; i < line % index_stride && position < limit; ++i) {
+            auto newline = (const char*)std::memchr(mapping.data() + position, '\n', limit - position);
+            if (newline == nullptr) return limit;
+            position = newline - mapping.data() + 1;
+        }
+        return std::min(position, limit);
+    }
+
+    std::pair<size_t, size_t> LogView::locate(const Mapping& mapping, size_t size, int64_t from, size_t count) {
+        if (count == 0 || from == 0) return {size, size};
+        auto data = mapping.data();
+        size_t begin;
+        if (from < 0) {
+            // walk back over -from line ends, the byte before size is the end of the last line. Negated unsigned,
+            // -INT64_MIN doesn't fit an int64_t
+            auto lines = 0 - (uint64_t)from;
+            begin = size;
+            for (uint64_t i = 0; i < lines && begin > 0; ++i) {
+                auto position = begin - 1;
+                while (position > 0 && data[position - 1] != '\n') --position;
+                begin = position;
+            }
+        } else {
+            UniqueLock lock{_mtx};
+            if (_indexed_bytes < size) extend(mapping, size);
+            auto line = (size_t)from - 1;
+            if (line >= _indexed_lines) return {size, size};
+            // another request may have indexed further than this one's size and mapping reach
+            begin = line_offset(mapping, line, size);
+            if (count < _indexed_lines - line) return {begin, line_offset(mapping, line + count, size)};
+            return {begin, size};
+        }
+        auto end = begin;
+        for (size_t i = 0; i < count && end < size; ++i) {
+            auto newline = (const char*)std::memchr(data + end, '\n', size - end);
+            end = newline != nullptr ? newline - data + 1 : size;
+        }
+        return {begin, end};
+    }
+} // Utilities
@@ -0,0 +1,69 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_LOGVIEW_H
+#define CLIENTSERVERCHATAPP_LOGVIEW_H
+
+namespace Utilities {
+    /**
+     * Memory-mapped, line-indexed view of the log, so a page of it can be found without reading what comes before.
+     * @details The log is only ever appended to and every line is written whole, so bytes that were there once never
+     * change and the index only has to be extended over what was logged since it was last used. The index is sparse,
+     * the offset of every index_stride-th line, which keeps it around a megabyte for a gigabyte of log while finding
+     * any line takes at most index_stride - 1 short scans. Pages counted from the end are found by scanning backwards
+     * instead, so the last lines of a huge log come back without indexing it first. Safe to use from any thread.
+     */
+    class LogView {
+    public:
+        /// Read-only mapping of the log, stays valid for whoever holds it even after the view remaps a grown file
+        class Mapping {
+        private:
+            const char* _data;
+            size_t _length;
+        public:
+            Mapping(const char* data, size_t length): _data(data), _length(length) {}
+            ~Mapping();
+            Mapping(const Mapping&) = delete;
+            Mapping& operator=(const Mapping&) = delete;
+            const char* data() const { return _data; }
+            /// Bytes mapped, only the ones the file actually had when they were asked for may be read
+            size_t length() const { return _length; }
+        };
+        /// Lines between two entries of the index
+        static constexpr size_t index_stride = 128;
+    private:
+        std::mutex _mtx;
+        std::string _path;
+        std::shared_ptr<const Mapping> _mapping;
+        /// Offset of line k * index_stride (counting from 0)
+        std::vector<uint64_t> _checkpoints{0};
+        /// Bytes indexed so far, always the end of a line
+        size_t _indexed_bytes{0};
+        /// Lines in those bytes
+        size_t _indexed_lines{0};
+        /// Indexes lines up to size bytes, _mtx must be held
+        void extend(const Mapping& mapping, size_t size);
+        /// Offset of a line that has been indexed, or limit if it starts past it. _mtx must be held
+        size_t line_offset(const Mapping& mapping, size_t line, size_t limit) const;
+    public:
+        /**
+         * Maps the log
+         * @param path log file, a different file than last time starts a new index
+         * @param size bytes the caller is going to read, the file must have at least that many
+         * @return nullptr if the file can't be mapped or size is 0
+         */
+        std::shared_ptr<const Mapping> map(const std::string& path, size_t size);
+        /**
+         * Finds a page of lines
+         * @param mapping from map, with the same size
+         * @param size bytes of the log that count, lines after it are ignored
+         * @param from first line, counting from 1, or from the end if negative (-1 is the last line)
+         * @param count most lines in the page
+         * @return first and one past the last byte of the page, equal if there are no such lines
+         */
+        std::pair<size_t, size_t> locate(const Mapping& mapping, size_t size, int64_t from, size_t count);
+    };
+} // Utilities
+
+#endif //CLIENTSERVERCHATAPP_LOGVIEW_H
@@ -3,21 +3,167 @@
 //
 
 #include "Logger.h"
+#include "MessageStore.h"
 #include <sstream>
-#include <fstream>
 #include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
 // Basically as long as whoever starts the server doesn't enter this secret hash a
 // temporary logger file will be generated with consideration to today's date and time.
 #define LOGGER_FILE_SECRET_HASH "uWJ0CU7dfbFUecigBPzjnPaC8vDKAuwZ89ybB0xRoR3fXJrIewPePnQZ6M2HCPIY7cH88334g+v0RfK0eJZc=="
 
+namespace {
+    /**
+     * The file and the thread writing to it.
+     * @details Callers push lines onto a lock-free list (a CAS on its head, no lock), the writer swaps the whole
+     * list out at once, so every line that piled up while the last batch was being written goes out together in
+     * one write(2) (group commit). The mutex is only taken to sleep and to wake the writer when the list goes from
+     * empty to not empty. The same batch goes into the MessageStore, which is written just as once per batch.
+     */
+    class AsyncLog {
+    private:
+        struct Node {
+            std::string line;
+            std::string sender;
+            /// Microseconds since the epoch
+            int64_t timestamp;
+            Node* next;
+        };
+        std::atomic<Node*> _head{nullptr};
+        std::mutex _mtx;
+        std::condition_variable _cv;
+        bool _stopping{false};
+        int _fd{-1};
+        std::string _path;
+        Utilities::LogSyncPolicy _sync;
+        /// Bytes in the file, lines are only counted once their whole batch is written
+        std::atomic<size_t> _written{0};
+        /// Bytes written since the last fsync
+        size_t _unsynced{0};
+        std::chrono::steady_clock::time_point _synced_at;
+        std::optional<Utilities::MessageStore> _store;
+        std::thread _writer;
 
-namespace Utilities {
-    std::string logger_file_path{LOGGER_FILE_SECRET_HASH};
-    std::mutex logger_mtx{};
-    void log(std::string message) {
-        UniqueLock lock{logger_mtx};
-        // default file is /tmp/chatapp<current date/time>.log
-        if (logger_file_path == LOGGER_FILE_SECRET_HASH) {
+        /// Writes one batch, oldest line first
+        void write_batch(Node* batch, std::string& buffer) {
+            // the list is newest first
+            Node* oldest = nullptr;
+            while (batch != nullptr) {
+                auto next = batch->next;
+                batch->next = oldest;
+                oldest = batch;
+                batch = next;
+            }
+            buffer.clear();
+            while (oldest != nullptr) {
+                if (!oldest->sender.empty()) {
+                    buffer += oldest->sender;
+                    buffer += ": ";
+                }
+                buffer += oldest->line;
+                buffer += '\n';
+                if (_store) _store->append(oldest->timestamp, oldest->sender, oldest->line);
+                auto next = oldest->next;
+                delete oldest;
+                oldest = next;
+            }
+            if (_store) _store->flush();
+            size_t offset = 0;
+            while (offset < buffer.size()) {
+                auto result = ::write(_fd, buffer.data() + offset, buffer.size() - offset);
+                if (result == -1 && errno == EINTR) continue;
+                // a log that can't be written is not worth taking the server down for
+                if (result <= 0) return;
+                offset += result;
+            }
+            _written.fetch_add(buffer.size(), std::memory_order_release);
+            _unsynced += buffer.size();
+            if (_sync.mode == Utilities::LogSync::BYTES && _unsynced >= _sync.bytes) sync();
+        }
+
+        void sync() {
+            if (_unsynced == 0) return;
+            ::fsync(_fd);
+            if (_store) _store->sync();
+            _unsynced = 0;
+            _synced_at = std::chrono::steady_clock::now();
+        }
+
+        void run() {
+            std::string buffer;
+            while (true) {
+                {
+                    UniqueLock lock{_mtx};
+                    auto ready = [this] { return _stopping || _head.load(std::memory_order_relaxed) != nullptr; };
+                    if (_sync.mode == Utilities::LogSync::INTERVAL && _unsynced > 0) {
+                        if (!_cv.wait_until(lock, _synced_at + _sync.interval, ready)) {
+                            lock.unlock();
+                            sync();
+                            continue;
+                        }
+                    } else {
+                        _cv.wait(lock, ready);
+                    }
+                }
+                auto batch = _head.exchange(nullptr, std::memory_order_acquire);
+                if (batch != nullptr) {
+                    write_batch(batch, buffer);
+                    if (_sync.mode == Utilities::LogSync::INTERVAL && std::chrono::steady_clock::now() - _synced_at >= _sync.interval) sync();
+                    continue;
+                }
+                // stopping and nothing left
+                if (_sync.mode != Utilities::LogSync::NONE) sync();
+                return;
+            }
+        }
+    public:
+        /**
+         * Opens the log and starts the writer
+         * @param store_directory where the MessageStore goes, empty for none
+         */
+        AsyncLog(std::string path, Utilities::LogSyncPolicy sync, const std::string& store_directory, size_t segment_bytes):
+            _path(std::move(path)), _sync(sync) {
+            _fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            struct stat status{};
+            if (_fd != -1 && ::fstat(_fd, &status) == 0) _written = (size_t)status.st_size;
+            if (!store_directory.empty()) {
+                _store.emplace(store_directory, segment_bytes);
+                if (!_store->is_open()) _store.reset();
+            }
+            _synced_at = std::chrono::steady_clock::now();
+            _writer = std::thread{[this] { run(); }};
+        }
+        /// Writes what's left and stops the writer, at exit
+        ~AsyncLog() {
+            {
+                UniqueLock lock{_mtx};
+                _stopping = true;
+            }
+            _cv.notify_one();
+            _writer.join();
+            if (_fd != -1) ::close(_fd);
+        }
+        void push(std::string sender, std::string line) {
+            auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            auto previous = _head.load(std::memory_order_relaxed);
+            auto node = new Node{std::move(line), std::move(sender), timestamp, previous};
+            while (!_head.compare_exchange_weak(previous, node, std::memory_order_release, std::memory_order_relaxed)) node->next = previous;
+            // only the first line of a batch has to wake the writer, the rest ride along. The node belongs to the
+            // writer once it's in the list, so previous is what's checked
+            if (previous == nullptr) {
+                { UniqueLock lock{_mtx}; }
+                _cv.notify_one();
+            }
+        }
+        std::pair<std::string, size_t> extent() const { return {_path, _written.load(std::memory_order_acquire)}; }
+        const Utilities::MessageStore* store() const { return _store ? &*_store : nullptr; }
+    };
+
+    AsyncLog& instance() {
+        // opened on first use, after main has had a chance to pick the files
+        static const std::string path = [] {
+            if (Utilities::logger_file_path != LOGGER_FILE_SECRET_HASH) return Utilities::logger_file_path;
+            // default file is /tmp/chatapp<current date/time>.log
             std::time_t t = std::time(nullptr);
             std::tm* now = std::localtime(&t);
             std::stringstream ss;
@@ -34,14 +180,37 @@ namespace Utilities {
                 << '-'
                 << now->tm_sec
                 << ".log";
-            logger_file_path = ss.str();
-        }
-        std::fstream fs{logger_file_path, std::ios_base::app | std::ios_base::out};
-        fs << message << '\n';
-        fs.close();
-//        in_memory_log.push_back(message);
+            return ss.str();
+        }();
+        static AsyncLog log{path, Utilities::logger_sync, [] {
+            if (!Utilities::logger_store) return std::string{};
+            if (!Utilities::logger_store_path.empty()) return Utilities::logger_store_path;
+            // next to the log, chatapp<date>.log keeps its messages in chatapp<date>.store
+            return (path.ends_with(".log") ? path.substr(0, path.size() - 4) : path) + ".store";
+        }(), Utilities::logger_segment_bytes};
+        return log;
+    }
+}
+
+namespace Utilities {
+    std::string logger_file_path{LOGGER_FILE_SECRET_HASH};
+    LogSyncPolicy logger_sync{};
+    bool logger_store{true};
+    std::string logger_store_path{};
+    size_t logger_segment_bytes{MessageStore::default_segment_bytes};
+    void log(std::string message) {
+        instance().push({}, std::move(message));
+    }
+    void log(std::string sender, std::string message) {
+        instance().push(std::move(sender), std::move(message));
+    }
+    std::pair<std::string, size_t> log_extent() {
+        return instance().extent();
+    }
+    const MessageStore* message_store() {
+        return instance().store();
     }
 } // Utilities
 
 // Paranoid undef just in case
-#undef LOGGER_FILE_SECRET_HASH
\ No newline at end of file
+#undef LOGGER_FILE_SECRET_HASH
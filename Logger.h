@@ -6,9 +6,53 @@
 #define CLIENTSERVERCHATAPP_LOGGER_H
 
 namespace Utilities {
+    /// When the log file is fsync'd, on top of being written
+    enum class LogSync {
+        /// Never, the kernel writes the file back whenever it likes
+        NONE,
+        /// At most LogSyncPolicy::interval after a line was written
+        INTERVAL,
+        /// Once LogSyncPolicy::bytes have been written since the last sync
+        BYTES
+    };
+    struct LogSyncPolicy {
+        LogSync mode{LogSync::NONE};
+        std::chrono::milliseconds interval{1000};
+        size_t bytes{1024 * 1024};
+    };
+    class MessageStore;
+    /// File lines are appended to, set before the first log call
     extern std::string logger_file_path;
-    extern std::mutex logger_mtx;
+    /// Set before the first log call
+    extern LogSyncPolicy logger_sync;
+    /// Whether what's logged also goes into a MessageStore, set before the first log call
+    extern bool logger_store;
+    /// Directory of the MessageStore, empty for next to the log file (chatapp<date>.store for chatapp<date>.log)
+    extern std::string logger_store_path;
+    /// Size the MessageStore's segments roll at
+    extern size_t logger_segment_bytes;
+    /**
+     * Appends a line to the log. The line is handed to a background thread that writes whatever has piled up with
+     * one write, so callers never wait on the file. Everything logged is written before the program exits.
+     * @param message line without its newline
+     */
     void log(std::string message);
+    /**
+     * Logs a chat message, the log gets "sender: message" and the MessageStore keeps the sender apart
+     * @param sender username
+     * @param message what they said
+     */
+    void log(std::string sender, std::string message);
+    /**
+     * What of the log can be read back
+     * @return path of the log file and how many bytes of it have been written, always the end of a line
+     */
+    std::pair<std::string, size_t> log_extent();
+    /**
+     * The store every logged line also goes into, with its sender and the time it was logged
+     * @return nullptr if there is none (turned off or it couldn't be opened)
+     */
+    const MessageStore* message_store();
 } // Utilities
 
 #endif //CLIENTSERVERCHATAPP_LOGGER_H
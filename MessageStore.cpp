@@ -0,0 +1,266 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#include "MessageStore.h"
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+    /// Digits of a segment's file name, enough for any sequence number so names sort like their numbers
+    constexpr size_t name_digits = 20;
+    constexpr std::string_view segment_extension = ".seg";
+}
+
+namespace Utilities {
+    MessageStore::MessageStore(std::string directory, size_t segment_bytes):
+        _directory(std::move(directory)), _segment_bytes(segment_bytes) {
+        std::error_code error;
+        std::filesystem::create_directories(_directory, error);
+        std::vector<uint64_t> bases;
+        for (const auto& entry : std::filesystem::directory_iterator{_directory, error}) {
+            auto name = entry.path().filename().string();
+            if (name.size() != name_digits + segment_extension.size() || !name.ends_with(segment_extension)) continue;
+            uint64_t base;
+            auto [end, parse_error] = std::from_chars(name.data(), name.data() + name_digits, base);
+            if (parse_error == std::errc{} && end == name.data() + name_digits) bases.push_back(base);
+        }
+        std::sort(bases.begin(), bases.end());
+        for (auto base : bases) {
+            Segment segment{.base = base, .next = base};
+            int fd = ::open(segment_path(base).c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) continue;
+            struct stat status{};
+            if (::fstat(fd, &status) == 0 && status.st_size > 0) segment.mapping = map(fd, (size_t)status.st_size);
+            ::close(fd);
+            if (segment.mapping != nullptr) recover(segment, (size_t)status.st_size);
+            // only the newest segment may be empty, the searches rely on it
+            if (!_segments.empty() && _segments.back().index.empty()) _segments.pop_back();
+            _segments.push_back(std::move(segment));
+        }
+        if (!_segments.empty()) _next_seq = _segments.back().next;
+        if (_segments.empty() || _segments.back().size >= _segment_bytes) {
+            roll();
+            return;
+        }
+        // carry on appending to the newest segment
+        auto& active = _segments.back();
+        _fd = ::open(segment_path(active.base).c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+        if (_fd == -1) return;
+        // a record cut short by a crash would be taken for the start of the next one
+        if (::ftruncate(_fd, (off_t)active.size) == -1) {
+            ::close(_fd);
+            _fd = -1;
+            return;
+        }
+        active.mapping = map(_fd, std::max(_segment_bytes, active.size));
+        _active_base = active.base;
+        _active_bytes = active.size;
+    }
+
+    MessageStore::~MessageStore() {
+        flush();
+        if (_fd != -1) ::close(_fd);
+    }
+
+    std::string MessageStore::segment_path(uint64_t base) const {
+        auto digits = std::to_string(base);
+        return _directory + '/' + std::string(name_digits - digits.size(), '0') + digits + std::string{segment_extension};
+    }
+
+    std::shared_ptr<const MessageStore::Mapping> MessageStore::map(int fd, size_t length) {
+        // the newest segment is mapped past the end of its file so it can grow into it, only the bytes that
+        // were written by then are ever read
+        auto data = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) return nullptr;
+        return std::make_shared<const Mapping>((const char*)data, length);
+    }
+
+    void MessageStore::recover(Segment& segment, size_t file_size) {
+        auto data = segment.mapping->data();
+        size_t offset = 0;
+        auto seq = segment.base;
+        while (file_size - offset >= sizeof(RecordHeader)) {
+            RecordHeader header;
+            std::memcpy(&header, data + offset, sizeof header);
+            if (header.size < sizeof header || header.size > file_size - offset
+                || header.sender_size > header.size - sizeof header || header.seq != seq) break;
+            if ((seq - segment.base) % index_stride == 0) segment.index.push_back({seq, header.timestamp, offset});
+            _last_timestamp = std::max(_last_timestamp, header.timestamp);
+            offset += header.size;
+            ++seq;
+        }
+        segment.size = offset;
+        segment.next = seq;
+    }
+
+    void MessageStore::roll() {
+        flush();
+        if (_fd != -1) {
+            // a finished segment is never written again, syncing it once here is all it takes
+            ::fsync(_fd);
+            ::close(_fd);
+        }
+        Segment segment{.base = _next_seq, .next = _next_seq};
+        _fd = ::open(segment_path(_next_seq).c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (_fd != -1) segment.mapping = map(_fd, _segment_bytes);
+        _active_base = _next_seq;
+        _active_bytes = 0;
+        UniqueLock lock{_mtx};
+        _segments.push_back(std::move(segment));
+    }
+
+    uint64_t MessageStore::append(int64_t timestamp, std::string_view sender, std::string_view body) {
+        if (_fd == -1) return 0;
+        // only possible with --max-message-size close to 4 GiB, the header couldn't describe the record
+        if (sender.size() + body.size() > UINT32_MAX - sizeof(RecordHeader)) return 0;
+        auto size = sizeof(RecordHeader) + sender.size() + body.size();
+        if (_active_bytes > 0 && _active_bytes + size > _segment_bytes) {
+            roll();
+            if (_fd == -1) return 0;
+        }
+        RecordHeader header{(uint32_t)size, (uint32_t)sender.size(), _next_seq, std::max(timestamp, _last_timestamp)};
+        if ((_next_seq - _active_base) % index_stride == 0) _pending_index.push_back({_next_seq, header.timestamp, _active_bytes});
+        _pending.append((const char*)&header, sizeof header);
+        _pending += sender;
+        _pending += body;
+        _active_bytes += size;
+        _last_timestamp = header.timestamp;
+        return _next_seq++;
+    }
+
+    void MessageStore::flush() {
+        if (_pending.empty()) return;
+        // the writer is the only one changing _segments, it can look without the lock
+        auto& active = _segments.back();
+        size_t offset = 0;
+        while (offset < _pending.size()) {
+            auto result = ::write(_fd, _pending.data() + offset, _pending.size() - offset);
+            if (result == -1 && errno == EINTR) continue;
+            if (result <= 0) {
+                // put the segment back the way readers know it, the records are lost like a line the log
+                // couldn't write
+                ::ftruncate(_fd, (off_t)active.size);
+                _active_bytes = active.size;
+                _next_seq = active.next;
+                _pending.clear();
+                _pending_index.clear();
+                return;
+            }
+            offset += result;
+        }
+        // a record bigger than a whole segment outgrows the mapping
+        std::shared_ptr<const Mapping> grown;
+        if (active.mapping == nullptr || active.mapping->length() < _active_bytes) grown = map(_fd, _active_bytes + _active_bytes / 2);
+        {
+            UniqueLock lock{_mtx};
+            if (grown != nullptr) active.mapping = std::move(grown);
+            active.size = _active_bytes;
+            active.next = _next_seq;
+            active.index.insert(active.index.end(), _pending_index.begin(), _pending_index.end());
+        }
+        _pending.clear();
+        _pending_index.clear();
+    }
+
+    void MessageStore::sync() {
+        if (_fd != -1) ::fsync(_fd);
+    }
+
+    uint64_t MessageStore::first_seq() const {
+        UniqueLock lock{_mtx};
+        return _segments.empty() ? 1 : _segments.front().base;
+    }
+
+    uint64_t MessageStore::next_seq() const {
+        UniqueLock lock{_mtx};
+        return _segments.empty() ? 1 : _segments.back().next;
+    }
+
+    const MessageStore::Segment* MessageStore::find(uint64_t seq) const {
+        if (_segments.empty()) return nullptr;
+        auto after = std::upper_bound(_segments.begin(), _segments.end(), seq, [](uint64_t seq, const Segment& segment) {
+            return seq < segment.base;
+        });
+        return after == _segments.begin() ? &_segments.front() : &*(after - 1);
+    }
+
+    uint64_t MessageStore::seq_at(int64_t timestamp) const {
+        std::shared_ptr<const Mapping> mapping;
+        size_t offset, size;
+        uint64_t next;
+        {
+            UniqueLock lock{_mtx};
+            if (_segments.empty()) return 1;
+            // the last segment starting before timestamp, the first record at or after it is in there or is the
+            // next segment's first
+            auto segment = std::partition_point(_segments.begin(), _segments.end(), [timestamp](const Segment& segment) {
+                return !segment.index.empty() && segment.index.front().timestamp < timestamp;
+            });
+            if (segment == _segments.begin()) return segment->base;
+            --segment;
+            if (segment->mapping == nullptr) return segment->next;
+            auto checkpoint = std::partition_point(segment->index.begin(), segment->index.end(), [timestamp](const Checkpoint& checkpoint) {
+                return checkpoint.timestamp < timestamp;
+            }) - 1;
+            mapping = segment->mapping;
+            offset = checkpoint->offset;
+            size = segment->size;
+            next = segment->next;
+        }
+        while (offset < size) {
+            RecordHeader header;
+            std::memcpy(&header, mapping->data() + offset, sizeof header);
+            if (header.timestamp >= timestamp) return header.seq;
+            offset += header.size;
+        }
+        return next;
+    }
+
+    size_t MessageStore::read(uint64_t from, size_t count, const std::function<void(const Message&)>& visit) const {
+        size_t read = 0;
+        while (read < count) {
+            std::shared_ptr<const Mapping> mapping;
+            size_t offset, size;
+            uint64_t first;
+            {
+                UniqueLock lock{_mtx};
+                auto segment = find(from);
+                if (segment == nullptr) break;
+                from = std::max(from, segment->base);
+                if (from >= segment->next || segment->mapping == nullptr) {
+                    // past this segment's records, the end of the store or a gap left by a damaged segment
+                    if (segment == &_segments.back()) break;
+                    from = (segment + 1)->base;
+                    continue;
+                }
+                auto checkpoint = std::upper_bound(segment->index.begin(), segment->index.end(), from, [](uint64_t seq, const Checkpoint& checkpoint) {
+                    return seq < checkpoint.seq;
+                }) - 1;
+                mapping = segment->mapping;
+                offset = checkpoint->offset;
+                size = segment->size;
+                first = from;
+                // whatever isn't read here is in the next segment
+                from = segment->next;
+            }
+            // the records up to size never change, no lock needed to read them
+            auto data = mapping->data();
+            while (offset < size && read < count) {
+                RecordHeader header;
+                std::memcpy(&header, data + offset, sizeof header);
+                if (header.seq >= first) {
+                    auto sender = data + offset + sizeof header;
+                    visit({header.seq, header.timestamp, {sender, header.sender_size},
+                           {sender + header.sender_size, header.size - sizeof header - header.sender_size}});
+                    ++read;
+                }
+                offset += header.size;
+            }
+        }
+        return read;
+    }
+} // Utilities
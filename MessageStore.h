@@ -0,0 +1,142 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_MESSAGESTORE_H
+#define CLIENTSERVERCHATAPP_MESSAGESTORE_H
+
+#include "LogView.h"
+
+namespace Utilities {
+    /**
+     * Append-only store of every message, split into segment files and read back through memory maps.
+     * @details Each message is a record with a sequence number, the server's timestamp, the sender and the body.
+     * Records go into the newest segment until it's full, then a new one is started (rolled), named after the
+     * sequence number of its first record. Segments that are done never change again, so history can later be
+     * thrown away by deleting whole files from the front.
+     *
+     * Every segment keeps a sparse index in memory, the sequence number, timestamp and offset of every
+     * index_stride-th record, built while appending and rebuilt from the records when the store is opened. A record
+     * is found by its sequence number or its time with a binary search over segments and their index and at most
+     * index_stride - 1 hops from record to record, without touching what comes before.
+     *
+     * One thread appends (the log writer), any thread may read. Appended records are only visible to readers once
+     * flushed, and a record cut short by a crash is dropped when the store is opened again.
+     */
+    class MessageStore {
+    public:
+        using Mapping = LogView::Mapping;
+        /// A record, the views point into a mapping and only live as long as the call that hands them out
+        struct Message {
+            uint64_t seq;
+            /// Microseconds since the epoch, never less than the record before
+            int64_t timestamp;
+            /// Empty for the server's own lines
+            std::string_view sender;
+            std::string_view body;
+        };
+        /// Records between two entries of a segment's index
+        static constexpr size_t index_stride = 128;
+        /// Size a segment rolls at unless told otherwise
+        static constexpr size_t default_segment_bytes = 64 * 1024 * 1024;
+    private:
+        /// What precedes sender and body on disk, in the machine's byte order
+        struct RecordHeader {
+            /// The whole record, header included
+            uint32_t size;
+            uint32_t sender_size;
+            uint64_t seq;
+            int64_t timestamp;
+        };
+        static_assert(sizeof(RecordHeader) == 24);
+        struct Checkpoint {
+            uint64_t seq;
+            int64_t timestamp;
+            uint64_t offset;
+        };
+        struct Segment {
+            /// Sequence number of the first record, also the file name
+            uint64_t base;
+            std::shared_ptr<const Mapping> mapping{};
+            /// Bytes readers may look at, always the end of a record
+            size_t size{0};
+            /// Sequence number after the last record readers may look at
+            uint64_t next;
+            /// Entry k is record k * index_stride of the segment
+            std::vector<Checkpoint> index{};
+        };
+        std::string _directory;
+        size_t _segment_bytes;
+        /// Oldest first, guarded by _mtx, readers copy what they need and read the mapping without it
+        std::vector<Segment> _segments;
+        mutable std::mutex _mtx;
+        // writer only
+        /// Newest segment, appended to
+        int _fd{-1};
+        /// Records not written yet
+        std::string _pending;
+        /// Index entries for them
+        std::vector<Checkpoint> _pending_index;
+        /// First sequence number of the newest segment
+        uint64_t _active_base{1};
+        /// Size of the newest segment and the next sequence number, counting what's pending
+        size_t _active_bytes{0};
+        uint64_t _next_seq{1};
+        int64_t _last_timestamp{0};
+
+        std::string segment_path(uint64_t base) const;
+        /// Reads a segment's records into its index, how far they're whole and the sequence number after them
+        void recover(Segment& segment, size_t file_size);
+        /// Maps an open segment file
+        static std::shared_ptr<const Mapping> map(int fd, size_t length);
+        /// Writes what's pending and starts a new segment
+        void roll();
+        /// Last segment starting at or before seq, the oldest if seq is older still, nullptr if none. _mtx must be held
+        const Segment* find(uint64_t seq) const;
+    public:
+        /**
+         * Opens a store, picking up where the records already in it end
+         * @param directory created if missing
+         * @param segment_bytes size a segment rolls at, a bigger record still gets a segment of its own
+         */
+        explicit MessageStore(std::string directory, size_t segment_bytes = default_segment_bytes);
+        ~MessageStore();
+        MessageStore(const MessageStore&) = delete;
+        MessageStore& operator=(const MessageStore&) = delete;
+        /// Whether the directory and the newest segment could be opened, appends go nowhere if not
+        bool is_open() const { return _fd != -1; }
+
+        /**
+         * Adds a record, writer thread only. It's written by the next flush
+         * @param timestamp microseconds since the epoch, raised to the last record's if it's earlier
+         * @return sequence number of the record, 0 if it wasn't stored (the store isn't open or the record is over
+         * 4 GiB)
+         */
+        uint64_t append(int64_t timestamp, std::string_view sender, std::string_view body);
+        /// Writes what was appended since the last flush and shows it to readers, writer thread only
+        void flush();
+        /// fsyncs the newest segment, writer thread only
+        void sync();
+
+        /// Sequence number of the oldest record, next_seq() if there are none
+        uint64_t first_seq() const;
+        /// Sequence number the next record will get
+        uint64_t next_seq() const;
+        /**
+         * Finds a point in time
+         * @param timestamp microseconds since the epoch
+         * @return sequence number of the first record at or after it, next_seq() if there is none
+         */
+        uint64_t seq_at(int64_t timestamp) const;
+        /**
+         * Reads records in order
+         * @param from sequence number of the first record, records that are gone are skipped
+         * @param count most records read
+         * @param visit called with every record
+         * @return records read
+         */
+        size_t read(uint64_t from, size_t count, const std::function<void(const Message&)>& visit) const;
+    };
+} // Utilities
+
+#endif //CLIENTSERVERCHATAPP_MESSAGESTORE_H
@@ -0,0 +1,232 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_PROTOCOL_H
+#define CLIENTSERVERCHATAPP_PROTOCOL_H
+
+namespace ClientServerChatApp {
+    /**
+     * What goes inside a frame.
+     * @details Clients that offer it right after connecting (see hello) speak the binary protocol: a message starts
+     * with one type byte, the opcode in the low 5 bits and flags in the top 3, followed by the opcode's body. Control
+     * signals are that one byte and dispatching is a switch on it. Everyone else keeps the text protocol, where
+     * commands are strings starting with $ and signals are long strings nobody types by accident (see Text). The
+     * server speaks both, so old and new clients can share a room.
+     */
+    namespace Protocol {
+        enum class Opcode : uint8_t {
+            // client to server
+            /// body: username
+            REGISTER = 1,
+            EXIT = 2,
+            GET_LIST = 3,
+            /// body: optional page of the log, the same "[from] [count]" as the text command
+            GET_LOG = 4,
+            /// body: message for the room
+            SAY = 5,
+            // server to client
+            /// The server accepted the binary protocol
+            WELCOME = 16,
+            /// The room is full, the connection is closed
+            FULL = 17,
+            /// The client fell too far behind and was disconnected
+            TOO_SLOW = 18,
+            /// Ends the entries answering GET_LIST or GET_LOG
+            DONE_SEND = 19,
+            /// body: a line from the server itself ([INFO], [ERROR], ...)
+            NOTICE = 20,
+            /// body: varint username length, username, message
+            CHAT = 21,
+            /// body: one username or log line answering GET_LIST or GET_LOG
+            ENTRY = 22,
+        };
+        /// Bits of the type byte that hold the opcode
+        constexpr uint8_t opcode_mask = 0x1f;
+        /// Bits of the type byte that hold flags. None are defined yet, senders leave them 0 and receivers ignore them
+        constexpr uint8_t flags_mask = 0xe0;
+        /// What a client offers in its hello and the server accepts
+        constexpr std::string_view binary_version = "binary/1";
+
+        /// The text protocol, also the commands users type
+        namespace Text {
+            constexpr std::string_view REGISTER = "$register ";
+            constexpr std::string_view EXIT = "$exit";
+            constexpr std::string_view GET_LIST = "$getlist";
+            constexpr std::string_view GET_LOG = "$getlog";
+            /// Sent right after connecting followed by binary_version, a server that answers WELCOME switches
+            constexpr std::string_view HELLO = "$hello ";
+            constexpr std::string_view SRV_FULL = "SRV_FULL KbpEWst/j5gpYunQfUZ1Ez1GcaR+n0J8nCEkUNWU/AafOR8QhrV6nu0wf3EGSA+HnRRVbFaDrAfMlmyD46RmMQ==";
+            constexpr std::string_view SRV_DONE_SEND = "SRV_DONE_SEND qnedR/eVlWUS/Q7t1WvNP5L9X5nInEi008+w1taykxb2Rcej53Fg/Nc0AlXS1/j1h1/gVaKhBnjF1wKy9X4LKg==";
+            constexpr std::string_view SRV_TOO_SLOW = "SRV_TOO_SLOW bqE510w7B1P+4Hy3KdALQ+pvxLcSfd6noKF7IMkv9foKRHjXVZfjlJHLMxI94ZCDzI+7jqLoBYHGBflsGr5fhA==";
+        }
+
+        /// The text message that offers the binary protocol
+        inline std::string hello() { return std::string{Text::HELLO} + std::string{binary_version}; }
+
+        /// A message from a client, whichever protocol it came in
+        struct Request {
+            Opcode opcode;
+            /// Username for REGISTER, message for SAY, page for GET_LOG, empty otherwise
+            std::string_view argument;
+        };
+
+        /// Lines of the log a GET_LOG asks for
+        struct LogPage {
+            /// First line, counting from 1, negative counts back from the end (-100 and on are the last 100 lines)
+            int64_t from{1};
+            /// Most lines sent
+            size_t count{SIZE_MAX};
+        };
+
+        /**
+         * Reads the argument of GET_LOG, "[from] [count]"
+         * @param argument empty for the whole log
+         * @return nothing if it isn't one or two numbers or from is 0
+         */
+        inline std::optional<LogPage> parse_log_page(std::string_view argument) {
+            LogPage page;
+            auto number = [&argument](auto& value) {
+                auto start = argument.find_first_not_of(' ');
+                if (start == std::string_view::npos) return false;
+                argument.remove_prefix(start);
+                auto [end, error] = std::from_chars(argument.data(), argument.data() + argument.size(), value);
+                if (error != std::errc{} || (end != argument.data() + argument.size() && *end != ' ')) return false;
+                argument.remove_prefix(end - argument.data());
+                return true;
+            };
+            if (argument.find_first_not_of(' ') == std::string_view::npos) return page;
+            if (!number(page.from) || page.from == 0) return std::nullopt;
+            if (argument.find_first_not_of(' ') == std::string_view::npos) return page;
+            if (!number(page.count) || argument.find_first_not_of(' ') != std::string_view::npos) return std::nullopt;
+            return page;
+        }
+
+        /**
+         * Reads a text protocol message, which is also how a typed line is turned into a request
+         * @param text message
+         * @return the command, SAY with the whole text if it isn't one
+         */
+        inline Request parse_command(std::string_view text) {
+            if (text.starts_with(Text::REGISTER)) return {Opcode::REGISTER, text.substr(Text::REGISTER.size())};
+            if (text.starts_with(Text::EXIT)) return {Opcode::EXIT, {}};
+            if (text.starts_with(Text::GET_LIST)) return {Opcode::GET_LIST, {}};
+            if (text.starts_with(Text::GET_LOG)) return {Opcode::GET_LOG, text.substr(Text::GET_LOG.size())};
+            return {Opcode::SAY, text};
+        }
+
+        /**
+         * Reads a binary protocol message from a client
+         * @param payload message, never empty since empty frames are heartbeats
+         * @return opcode and body, an opcode this build doesn't know is returned as is
+         */
+        inline Request decode_request(std::string_view payload) {
+            if (payload.empty()) return {Opcode{0}, {}};
+            return {(Opcode)((uint8_t)payload[0] & opcode_mask), payload.substr(1)};
+        }
+
+        /// Spells a request the way the text protocol does
+        inline std::string to_text(const Request& request) {
+            switch (request.opcode) {
+                case Opcode::REGISTER: return std::string{Text::REGISTER} + std::string{request.argument};
+                case Opcode::EXIT: return std::string{Text::EXIT};
+                case Opcode::GET_LIST: return std::string{Text::GET_LIST};
+                case Opcode::GET_LOG: return std::string{Text::GET_LOG} + std::string{request.argument};
+                default: return std::string{request.argument};
+            }
+        }
+
+        // What the server sends. Each message has its binary body (append_body) and how the text protocol spells it
+        // (to_text), WELCOME only exists in the binary protocol.
+        struct Welcome { static constexpr Opcode opcode = Opcode::WELCOME; };
+        struct Full { static constexpr Opcode opcode = Opcode::FULL; };
+        struct TooSlow { static constexpr Opcode opcode = Opcode::TOO_SLOW; };
+        struct DoneSend { static constexpr Opcode opcode = Opcode::DONE_SEND; };
+        struct Notice {
+            static constexpr Opcode opcode = Opcode::NOTICE;
+            std::string_view text;
+        };
+        struct Chat {
+            static constexpr Opcode opcode = Opcode::CHAT;
+            std::string_view username;
+            std::string_view text;
+        };
+        struct Entry {
+            static constexpr Opcode opcode = Opcode::ENTRY;
+            std::string_view text;
+        };
+
+        inline void append_body(std::string& out, const Request& request) { out += request.argument; }
+        inline void append_body(std::string&, const Welcome&) {}
+        inline void append_body(std::string&, const Full&) {}
+        inline void append_body(std::string&, const TooSlow&) {}
+        inline void append_body(std::string&, const DoneSend&) {}
+        inline void append_body(std::string& out, const Notice& notice) { out += notice.text; }
+        inline void append_body(std::string& out, const Entry& entry) { out += entry.text; }
+        inline void append_body(std::string& out, const Chat& chat) {
+            char header[LibSocket::Socket<SocketSizeType>::max_header_size];
+            out.append(header, LibSocket::Socket<SocketSizeType>::encode_header(chat.username.size(), header));
+            out += chat.username;
+            out += chat.text;
+        }
+
+        inline std::string to_text(const Full&) { return std::string{Text::SRV_FULL}; }
+        inline std::string to_text(const TooSlow&) { return std::string{Text::SRV_TOO_SLOW}; }
+        inline std::string to_text(const DoneSend&) { return std::string{Text::SRV_DONE_SEND}; }
+        inline std::string to_text(const Notice& notice) { return std::string{notice.text}; }
+        inline std::string to_text(const Entry& entry) { return std::string{entry.text}; }
+        inline std::string to_text(const Chat& chat) { return std::string{chat.username} + ": " + std::string{chat.text}; }
+
+        /**
+         * Encodes a message for the binary protocol
+         * @param message any of the messages above, or a Request
+         * @return type byte followed by the body
+         */
+        template<typename Message>
+        std::string encode_binary(const Message& message) {
+            std::string out(1, (char)message.opcode);
+            append_body(out, message);
+            return out;
+        }
+
+        /// A message from the server the way the client shows it
+        struct Reply {
+            Opcode opcode;
+            /// What to print, empty for signals
+            std::string text;
+        };
+
+        /**
+         * Reads a message from the server
+         * @param payload message
+         * @param binary whether the binary protocol was negotiated
+         * @return in the text protocol, signals are recognised and everything else is a NOTICE
+         */
+        inline Reply read_reply(std::string_view payload, bool binary) {
+            if (!binary) {
+                if (payload == Text::SRV_FULL) return {Opcode::FULL, {}};
+                if (payload == Text::SRV_DONE_SEND) return {Opcode::DONE_SEND, {}};
+                if (payload == Text::SRV_TOO_SLOW) return {Opcode::TOO_SLOW, {}};
+                return {Opcode::NOTICE, std::string{payload}};
+            }
+            if (payload.empty()) return {Opcode{0}, {}};
+            auto opcode = (Opcode)((uint8_t)payload[0] & opcode_mask);
+            auto body = payload.substr(1);
+            switch (opcode) {
+                case Opcode::NOTICE:
+                case Opcode::ENTRY:
+                    return {opcode, std::string{body}};
+                case Opcode::CHAT: {
+                    size_t length;
+                    auto header = LibSocket::Socket<SocketSizeType>::decode_header(body.data(), body.size(), length);
+                    if (header <= 0 || length > body.size() - header) return {Opcode{0}, {}};
+                    return {opcode, to_text(Chat{body.substr(header, length), body.substr(header + length)})};
+                }
+                default:
+                    return {opcode, {}};
+            }
+        }
+    }
+}
+
+#endif //CLIENTSERVERCHATAPP_PROTOCOL_H
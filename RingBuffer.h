@@ -5,46 +5,171 @@
 #ifndef CLIENTSERVERCHATAPP_RINGBUFFER_H
 #define CLIENTSERVERCHATAPP_RINGBUFFER_H
 
-#include <mutex>
-#include <queue>
-#include <condition_variable>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
 
 namespace Utilities {
+    /// How many threads may push into a RingBuffer at once, it's always drained by one
+    enum class RingProducers {
+        SINGLE,
+        MULTIPLE
+    };
+
     /**
-     * Totally awesome and super cool ring buffer algorithm
-     * allows for one or more threads to enqueue data to another thread
-     * @tparam T
+     * Fixed-capacity lock-free ring that hands values from producer threads to one consumer thread.
+     * @details Every slot carries a sequence number that says whose turn it is: the producer of position p may
+     * write the slot once it reads p, the consumer may take it once it reads p + 1, and taking it sets it to
+     * p + Capacity for the producer one lap later. Producers and the consumer therefore only ever meet on the
+     * slot they're handing over, the head and tail indices sit on cache lines of their own and are never written
+     * by the other side. With several producers the tail is claimed with a CAS, a single producer just bumps it.
+     *
+     * Nothing locks and nothing allocates. The consumer only sleeps when the ring is empty, on an atomic wait
+     * (a futex on Linux), and producers only pay for the wakeup when it's actually asleep. A full ring makes
+     * try_push fail, tx yields until there's room.
+     * @tparam T stored value, has to be default constructible and move assignable
+     * @tparam Capacity slots, a power of two
+     * @tparam Producers whether more than one thread pushes
      */
-    template<typename T>
+    template<typename T, size_t Capacity, RingProducers Producers = RingProducers::MULTIPLE>
     class RingBuffer {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
     private:
-        std::mutex mtx;
-        std::condition_variable cv;
-        std::queue<T> buffer;
+        static constexpr size_t cache_line = 64;
+        static constexpr size_t mask = Capacity - 1;
+        struct Slot {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+        std::array<Slot, Capacity> _slots;
+        /// Next position a producer writes
+        alignas(cache_line) std::atomic<size_t> _tail{0};
+        /// Next position the consumer reads, only the consumer touches it
+        alignas(cache_line) size_t _head{0};
+        /// Bumped by a producer that finds the consumer asleep, the consumer waits on it
+        alignas(cache_line) std::atomic<uint32_t> _epoch{0};
+        std::atomic<bool> _waiting{false};
+
+        /// Whether the next value is there, consumer only
+        bool readable() const { return _slots[_head & mask].sequence.load(std::memory_order_acquire) == _head + 1; }
+
+        /// Wakes the consumer if it went to sleep
+        void wake() {
+            // pairs with the fence in sleep_until_readable: either the consumer sees the new value or this sees _waiting
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // only the first producer to find it asleep pays for the wakeup, the rest see it cleared
+            if (!_waiting.load(std::memory_order_relaxed) || !_waiting.exchange(false, std::memory_order_relaxed)) return;
+            _epoch.fetch_add(1, std::memory_order_release);
+            _epoch.notify_one();
+        }
+
+        /// Blocks the consumer until the ring isn't empty
+        void sleep_until_readable() {
+            while (!readable()) {
+                auto epoch = _epoch.load(std::memory_order_acquire);
+                _waiting.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!readable()) _epoch.wait(epoch, std::memory_order_acquire);
+                _waiting.store(false, std::memory_order_relaxed);
+            }
+        }
     public:
+        RingBuffer() {
+            for (size_t i = 0; i < Capacity; ++i) _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+
+        /**
+         * Adds a value if there's room
+         * @param value moved from only if it was added
+         * @return false if the ring is full
+         */
+        bool try_push(T&& value) {
+            auto position = _tail.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &_slots[position & mask];
+                auto sequence = slot->sequence.load(std::memory_order_acquire);
+                // the consumer hasn't taken what was written here a lap ago
+                if (sequence < position) return false;
+                if constexpr (Producers == RingProducers::SINGLE) {
+                    _tail.store(position + 1, std::memory_order_relaxed);
+                    break;
+                } else {
+                    // another producer claimed the slot first, retry with the position it left
+                    if (sequence == position && _tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                    if (sequence != position) position = _tail.load(std::memory_order_relaxed);
+                }
+            }
+            slot->value = std::move(value);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            wake();
+            return true;
+        }
+        /**
+         * Takes the oldest value if there is one, consumer only
+         * @param out where it's moved to
+         * @return false if the ring is empty
+         */
+        bool try_pop(T& out) {
+            if (!readable()) return false;
+            auto& slot = _slots[_head & mask];
+            out = std::move(slot.value);
+            slot.sequence.store(_head + Capacity, std::memory_order_release);
+            ++_head;
+            return true;
+        }
+        /**
+         * Takes everything that's there, up to max values, without blocking. Consumer only
+         * @param out output iterator the values are moved to, oldest first
+         * @param max most values taken
+         * @return values taken
+         */
+        template<typename Output>
+        size_t drain(Output out, size_t max) {
+            size_t count = 0;
+            for (; count < max && readable(); ++count) {
+                auto& slot = _slots[_head & mask];
+                *out++ = std::move(slot.value);
+                slot.sequence.store(_head + Capacity, std::memory_order_release);
+                ++_head;
+            }
+            return count;
+        }
+        /// Blocks until there is something to take, consumer only
+        void wait() { sleep_until_readable(); }
+
         /**
-         * Transmit data to consumer
+         * Transmit data to consumer, waits for room if the ring is full
          * @param data to send
          */
-        void tx(T data) {
-            std::unique_lock<std::mutex> lock{mtx};
-            buffer.push(data);
-            cv.notify_all();
+        void tx(T&& data) {
+            // the consumer would have to be a whole ring behind, rare enough that yielding beats a second wait
+            while (!try_push(std::move(data))) std::this_thread::yield();
         }
         /**
-         * Receive data from producers
+         * Receive data from producers, blocks while the ring is empty
          * @return data
          */
         T rx() {
-            std::unique_lock<std::mutex> lock{mtx};
-            if (buffer.empty()) {
-                cv.wait(lock, [&] { return !buffer.empty();});
-            }
-            auto rv = buffer.front();
-            buffer.pop();
-            return rv;
+            sleep_until_readable();
+            T data;
+            try_pop(data);
+            return data;
         }
+        static constexpr size_t capacity() { return Capacity; }
     };
+
+    /// RingBuffer for one producer thread
+    template<typename T, size_t Capacity>
+    using SpscRing = RingBuffer<T, Capacity, RingProducers::SINGLE>;
+    /// RingBuffer for any number of producer threads
+    template<typename T, size_t Capacity>
+    using MpscRing = RingBuffer<T, Capacity, RingProducers::MULTIPLE>;
 }
 
 #endif //CLIENTSERVERCHATAPP_RINGBUFFER_H
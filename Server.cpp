@@ -3,12 +3,31 @@
 //
 
 #include "Server.h"
-#include "Commands.h"
 #include "Logger.h"
 #include "ShutdownTasks.h"
-#include <fstream>
+#include <cstring>
 #include <getopt.h>
 
+namespace {
+    /// Packs what a request or timer is for and the connection's key (24 bit index, 32 bit generation) into 64 bits
+    uint64_t tag(uint64_t kind, Utilities::SlotKey key) {
+        return kind << 56 | (uint64_t)key.generation << 24 | (key.index & 0xffffff);
+    }
+    Utilities::SlotKey tag_key(uint64_t tag) { return {(uint32_t)tag & 0xffffff, (uint32_t)(tag >> 24)}; }
+    /// What a submitted io_uring request was for
+    enum class RingOp : uint64_t { ACCEPT = 1, RECV = 2, SEND = 3, WAKE = 4 };
+    /// user_data of a request
+    uint64_t ring_tag(RingOp op, Utilities::SlotKey key = {}) { return tag((uint64_t)op, key); }
+    RingOp ring_op(uint64_t tag) { return (RingOp)(tag >> 56); }
+    /// What a connection's timer is for
+    enum class TimerKind : uint64_t { IDLE = 1, SEND = 2 };
+    /// Payload of a timer
+    uint64_t timer_tag(TimerKind kind, Utilities::SlotKey key) { return tag((uint64_t)kind, key); }
+    TimerKind timer_kind(uint64_t tag) { return (TimerKind)(tag >> 56); }
+    /// Accepts kept in flight by the io_uring backend so a burst of connections completes in one batch
+    constexpr int ring_accept_depth = 8;
+}
+
 namespace ClientServerChatApp {
 
     void Server::run_server(Server* server, std::string port, std::string ip = "127.0.0.1") {
@@ -17,86 +36,126 @@ namespace ClientServerChatApp {
             server->console->push_message(msg);
             Utilities::log(msg);
         };
-        // Accept error handlers
-        server->accept_handlers[LibSocket::SocketAcceptError::SUCCESS] = [&](std::shared_ptr<Socket> client) {
-            if (server->_client_sockets.size() == server->_max_users) {
-                client->full_send(MessageSignals::SRV_FULL(), {});
+        std::function<void()> fcntl_err_handler = [&] {
+            std::string msg = "[ERROR]: Failed to make client socket non-blocking";
+            server->console->push_message(msg);
+            Utilities::log(msg);
+        };
+        // Client handlers, built once and shared by every accepted socket. They only reach the connection through
+        // the Socket* they're called with, never through a capture
+        for (auto err : LibSocket::all_fcntl_errors) server->_client_protocol.fcntl[err] = fcntl_err_handler;
+        server->_client_protocol.receive[LibSocket::SocketReceiveError::SUCCESS] = [&](const std::string& msg, Socket* client) {
+            if (msg.empty()) return;
+            using Protocol::Opcode;
+            auto connection = server->connection(client->get_fd());
+            // the binary protocol is offered in text before anything else, an old server rejects it as chat
+            if (connection->state == ConnectionState::CONNECTED && !connection->binary && msg.starts_with(Protocol::Text::HELLO)) {
+                if (std::string_view{msg}.substr(Protocol::Text::HELLO.size()) != Protocol::binary_version) {
+                    server->unicast(client, Protocol::Notice{"[ERROR]: Unsupported protocol"});
+                    return;
+                }
+                connection->binary = true;
+                server->enqueue(*connection, make_frame(Protocol::encode_binary(Protocol::Welcome{})));
                 return;
             }
-            server->_client_sockets.push_back(client);
-            std::string conn_msg = "[INFO]: A new client has connected!";
-            server->console->push_message(conn_msg);
-            client->receive_handlers[LibSocket::SocketReceiveError::SUCCESS] = [&](const std::string msg, Socket* client) {
-                if (msg.empty()) return;
-                if (msg.starts_with(Commands::REGISTER())) {
-                    if (msg.size() == Commands::REGISTER().size()) {
-                        client->full_send("[ERROR]: Missing username", {});
+            auto request = connection->binary ? Protocol::decode_request(msg) : Protocol::parse_command(msg);
+            if (request.opcode != Opcode::REGISTER && connection->state != ConnectionState::REGISTERED) {
+                server->unicast(client, Protocol::Notice{"[ERROR]: You must register to send messages!"});
+                return;
+            }
+            switch (request.opcode) {
+                case Opcode::REGISTER: {
+                    if (request.argument.empty()) {
+                        server->unicast(client, Protocol::Notice{"[ERROR]: Missing username"});
+                        return;
+                    }
+                    if (request.argument.size() > max_username_size) {
+                        server->unicast(client, Protocol::Notice{"[ERROR]: Usernames can be at most " + std::to_string(max_username_size) + " bytes"});
                         return;
                     }
-                    std::string username = msg.substr(Commands::REGISTER().size());
-                    server->users[client->get_fd()] = username;
+                    std::string username{request.argument};
+                    {
+                        UniqueLock lock{server->_connections_mtx};
+                        connection->username = username;
+                        connection->state = ConnectionState::REGISTERED;
+                    }
+                    // taken before the join notice goes into the history
+                    auto history = server->history_for(*connection);
                     std::string derp{"[INFO]: " + username + " has joined the chat!"};
-                    server->broadcast(derp);
+                    server->broadcast(Protocol::Notice{derp});
+                    server->enqueue(*connection, history, true);
                     server->console->push_message(derp);
                     return;
                 }
-                if(!server->users.contains(client->get_fd())) {
-                    client->full_send("[ERROR]: You must register to send messages!", {});
-                    return;
-                }
-                if (msg.starts_with(Commands::EXIT())) {
-                    auto message = std::string("[INFO]: " + server->users[client->get_fd()] + " disconnected.");
-                    server->broadcast(message);
+                case Opcode::EXIT: {
+                    auto message = std::string("[INFO]: " + connection->username + " disconnected.");
+                    server->broadcast(Protocol::Notice{message});
                     server->console->push_message(message);
-                    for (size_t i = 0; i < server->_client_sockets.size(); i++) {
-                        if (server->_client_sockets[i]->get_fd() == client->get_fd()) {
-                            server->_client_sockets.erase(server->_client_sockets.begin() + i);
-                            break;
-                        }
-                    }
+                    server->disconnect(client);
                     return;
                 }
-                if (msg.starts_with(Commands::GET_LIST())) {
-                    for (auto i = server->users.begin(); i != server->users.end(); i++) {
-                        client->full_send(i->second, {});
-                    }
-                    client->full_send(MessageSignals::SRV_DONE_SEND(), {});
+                case Opcode::GET_LIST:
+                case Opcode::GET_LOG:
+                    // reading the log or every shard's usernames would hold up everyone else's chat
+                    server->start_job(*connection, request.opcode, request.argument);
                     return;
-                }
-                if (msg.starts_with(Commands::GET_LOG())) {
-                    std::string line;
-                    UniqueLock lock{Utilities::logger_mtx};
-                    std::ifstream file{Utilities::logger_file_path};
-                    // send every line of the file
-                    while(getline(file, line)) {
-                        client->full_send(line, {});
-                    }
-                    client->full_send(MessageSignals::SRV_DONE_SEND(), {});
-                    // let client deal with what to do next
+                case Opcode::SAY: {
+                    if (request.argument.empty()) return;
+                    Protocol::Chat chat{connection->username, request.argument};
+                    server->broadcast(chat);
+                    Utilities::log(connection->username, std::string{request.argument});
+                    server->console->push_message(Protocol::to_text(chat));
                     return;
                 }
-                std::string response = server->users[client->get_fd()] + ": " + msg;
-                server->broadcast(response);
-                Utilities::log(response);
-                server->console->push_message(response);
-            };
-            for (auto err : LibSocket::all_receive_errors) {
-                client->receive_handlers[err] = receive_err_handler;
-            }
-            client->receive_handlers[LibSocket::SocketReceiveError::DISCONNECTING] = [&] (const std::string& payload, Socket* socket) {
-                std::string username{};
-                if (server->users.contains(socket->get_fd())) username = server->users[socket->get_fd()];
-                for(size_t i = 0; i < server->_client_sockets.size(); ++i) {
-                    if (socket->get_fd() == server->_client_sockets[i]->get_fd()) {
-//                        delete server->_client_sockets[i];
-//                        server->_client_sockets.erase(server->_client_sockets.begin() + i);
-                        break;
-                    }
-                }
-                if (username.empty()) return;
-                std::string msg = "[INFO]: " + username + " disconnected";
-                server->broadcast(msg);
+                default:
+                    server->unicast(client, Protocol::Notice{"[ERROR]: Unknown request"});
+                    return;
+            }
+        };
+        for (auto err : LibSocket::all_receive_errors) {
+            server->_client_protocol.receive[err] = [&](const std::string& payload, Socket* socket) {
+                receive_err_handler(payload, socket);
+                // the connection is broken, nothing more will come from it
+                server->disconnect(socket);
             };
+        }
+        // clients are non-blocking, running out of data is how every read ends
+        server->_client_protocol.receive.erase(LibSocket::SocketReceiveError::AGAIN);
+        server->_client_protocol.receive.erase(LibSocket::SocketReceiveError::WOULD_BLOCK);
+        // a signal got in the way, the socket is fine
+        server->_client_protocol.receive[LibSocket::SocketReceiveError::INTERRUPTED] = receive_err_handler;
+        server->_client_protocol.receive[LibSocket::SocketReceiveError::MESSAGE_TOO_LARGE] = [&] (const std::string& payload, Socket* socket) {
+            // the rest of the stream can't be framed anymore, the client has to go
+            std::string msg = "[WARNING]: Disconnected a client that sent a message over " + std::to_string(socket->max_message_size) + " bytes";
+            server->console->push_message(msg);
+            Utilities::log(msg);
+            server->disconnect(socket);
+        };
+        server->_client_protocol.receive[LibSocket::SocketReceiveError::DISCONNECTING] = [&] (const std::string& payload, Socket* socket) {
+            auto connection = server->connection(socket->get_fd());
+            std::string username = connection != nullptr ? connection->username : "";
+            server->disconnect(socket);
+            if (username.empty()) return;
+            std::string msg = "[INFO]: " + username + " disconnected";
+            server->broadcast(Protocol::Notice{msg});
+        };
+        // Accept error handlers
+        server->accept_handlers[LibSocket::SocketAcceptError::SUCCESS] = [&](std::shared_ptr<Socket> client) {
+            // the limit is shared by every shard
+            if (server->shards->connected.fetch_add(1) >= server->_max_users) {
+                server->shards->connected.fetch_sub(1);
+                // nothing has been negotiated yet, every client understands the text signal
+                client->full_send(Protocol::to_text(Protocol::Full{}), {});
+                return;
+            }
+            // anything larger couldn't be relayed to the other clients
+            client->max_message_size = std::min(server->max_message_size, max_inbound_message_size);
+            // sharing the tables is a reference count, nothing is allocated per connection
+            client->receive_handlers = server->_client_protocol.receive;
+            client->fcntl_handlers = server->_client_protocol.fcntl;
+            server->watch(std::move(client));
+            std::string conn_msg = "[INFO]: A new client has connected!";
+            server->console->push_message(conn_msg);
             Utilities::log(conn_msg);
 
         };
@@ -108,9 +167,12 @@ namespace ClientServerChatApp {
         for (auto err : LibSocket::all_accept_errors) server->accept_handlers[err] = accept_err_handler;
         // Create error handlers
         server->create_handlers[LibSocket::SocketCreateError::SUCCESS] = [&] {
-            std::string msg = "[INFO]: Socket created.";
-            server->console->push_message(msg);
-            Utilities::log(msg);
+            // every shard creates a socket, only announce it once
+            if (server->shard_id == 0) {
+                std::string msg = "[INFO]: Socket created.";
+                server->console->push_message(msg);
+                Utilities::log(msg);
+            }
             server->sync_socket_created.resolve(true);
         };
         std::function<void()> create_err_handler = [&] {
@@ -123,7 +185,9 @@ namespace ClientServerChatApp {
         for (auto err : LibSocket::all_create_errors) { server->create_handlers[err] = create_err_handler; }
         // Listen error handlers
         server->listen_handlers[LibSocket::SocketListenError::SUCCESS] = [&] {
+            if (server->shard_id != 0) return;
             std::string msg = "[INFO]: Server listening on port " + port;
+            if (server->shards->servers.size() > 1) msg += " with " + std::to_string(server->shards->servers.size()) + " threads";
             server->console->push_message(msg);
             Utilities::log(msg);
         };
@@ -135,12 +199,12 @@ namespace ClientServerChatApp {
         };
         for (auto err : LibSocket::all_listen_errors) { server->listen_handlers[err] = listen_err_handler; }
         // Send error handlers
-        server->send_handlers[LibSocket::SocketSendError::SUCCESS] = [&](const std::string& payload) {
+        server->send_handlers[LibSocket::SocketSendError::SUCCESS] = [&](std::string_view payload) {
 //            std::string msg = "";
 //            server->console->push_message(msg);
 //            Utilities::log(msg);
         };
-        server->send_handlers[LibSocket::SocketSendError::PIPE] = [&](const std::string& payload) {
+        server->send_handlers[LibSocket::SocketSendError::PIPE] = [&](std::string_view payload) {
             std::string msg = "[ERROR]: Message failed to send due to local socket being severed";
             server->console->push_message(msg);
             Utilities::log(msg);
@@ -150,16 +214,89 @@ namespace ClientServerChatApp {
 //
 //        };
         for (auto err : LibSocket::all_receive_errors) server->receive_handlers[err] = receive_err_handler;
+        // Reactor error handlers
+        std::function<void()> reactor_create_err_handler = [&] {
+            std::string msg = "[ERROR]: Event reactor failed to be created.";
+            server->console->shutdown.store(true);
+            server->console->push_message(msg);
+            Utilities::log(msg);
+        };
+        for (auto err : LibSocket::all_reactor_errors) server->reactor.create_handlers[err] = reactor_create_err_handler;
+        std::function<void(int)> reactor_control_err_handler = [&](int fd) {
+            std::string msg = "[ERROR]: Failed to register socket with the event reactor.";
+            server->console->push_message(msg);
+            Utilities::log(msg);
+        };
+        for (auto err : LibSocket::all_reactor_errors) server->reactor.control_handlers[err] = reactor_control_err_handler;
+        std::function<void()> reactor_wait_err_handler = [&] {
+            std::string msg = "[ERROR]: Failed to wait on the event reactor.";
+            server->console->push_message(msg);
+            Utilities::log(msg);
+        };
+        for (auto err : LibSocket::all_reactor_errors) server->reactor.wait_handlers[err] = reactor_wait_err_handler;
+        // a signal landing mid-wait is harmless, the loop just goes around again
+        server->reactor.wait_handlers.erase(LibSocket::ReactorError::INTERRUPTED);
+        // io_uring error handlers
+        std::function<void()> ring_create_err_handler = [&] {
+            std::string msg = "[WARNING]: io_uring is unavailable, falling back to the event reactor.";
+            server->backend = IOBackend::REACTOR;
+            server->console->push_message(msg);
+            Utilities::log(msg);
+        };
+        for (auto err : LibSocket::all_io_uring_errors) server->ring.create_handlers[err] = ring_create_err_handler;
+        std::function<void()> ring_submit_err_handler = [&] {
+            std::string msg = "[ERROR]: Failed to submit I/O requests.";
+            server->console->push_message(msg);
+            Utilities::log(msg);
+        };
+        for (auto err : LibSocket::all_io_uring_errors) server->ring.submit_handlers[err] = ring_submit_err_handler;
+        server->ring.submit_handlers.erase(LibSocket::IoUringError::INTERRUPTED);
+        std::function<void()> waker_create_err_handler = [&] {
+            std::string msg = "[ERROR]: Failed to create the cross-thread waker.";
+            server->console->shutdown.store(true);
+            server->console->push_message(msg);
+            Utilities::log(msg);
+        };
+        for (auto err : LibSocket::all_reactor_errors) server->waker.create_handlers[err] = waker_create_err_handler;
 
-        server->udp_socket.create(LibSocket::SocketFamily::INET, LibSocket::Type::DATAGRAM);
-        int reuse = 1;
-        setsockopt(server->udp_socket.get_fd(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
-        setsockopt(server->udp_socket.get_fd(), SOL_SOCKET, SO_BROADCAST, &reuse, sizeof reuse);
+        server->_history = Utilities::HistoryRing<EncodedMessage>{server->history_size};
         // Start server in order
         server->create(LibSocket::SocketFamily::INET, LibSocket::Type::STREAM);
+        if (server->shards->servers.size() > 1) {
+            // lets every shard bind the same port, the kernel load balances connections between them
+            int reuse_port = 1;
+            if (setsockopt(server->get_fd(), SOL_SOCKET, SO_REUSEPORT, &reuse_port, sizeof reuse_port) == -1) {
+                // the bind below fails for every shard after the first
+                std::string msg = "[ERROR]: Failed to share port " + port + " between threads.";
+                server->console->shutdown.store(true);
+                server->console->push_message(msg);
+                Utilities::log(msg);
+            }
+        }
         server->bind_v4(ip, port);
         server->listen();
-        std::thread udp_broadcaster{[&] {
+        server->waker.create();
+        if (server->backend == IOBackend::IO_URING) server->ring.create();
+        if (server->backend == IOBackend::IO_URING) {
+            for (int i = 0; i < ring_accept_depth; ++i) {
+                server->ring.prepare_accept(server->get_fd(), ring_tag(RingOp::ACCEPT));
+            }
+            server->ring.prepare_poll(server->waker.read_fd(), ring_tag(RingOp::WAKE));
+        } else {
+            server->reactor.create();
+            // every wakeup accepts until the backlog is empty (or a batch is full), that needs a listener that can't block
+            server->set_non_blocking(true);
+            // level-triggered, connections left over from a full batch wake the next iteration
+            server->reactor.add(server->get_fd(), {LibSocket::ReactorInterest::READ});
+            server->reactor.add(server->waker.read_fd(), {LibSocket::ReactorInterest::READ, LibSocket::ReactorInterest::EDGE_TRIGGERED});
+        }
+        // only one shard has to advertise the server
+        std::thread udp_broadcaster;
+        if (server->shard_id == 0) udp_broadcaster = std::thread{[&] {
+            server->udp_socket.create(LibSocket::SocketFamily::INET, LibSocket::Type::DATAGRAM);
+            int reuse = 1;
+            setsockopt(server->udp_socket.get_fd(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
+            setsockopt(server->udp_socket.get_fd(), SOL_SOCKET, SO_BROADCAST, &reuse, sizeof reuse);
             struct sockaddr_in broadcast;
             std::memset(&broadcast, 0, sizeof broadcast);
             broadcast.sin_family = AF_INET;
@@ -178,7 +315,6 @@ namespace ClientServerChatApp {
             connection_addr.sin_port = nport;
             while (!server->console->shutdown.load()) {
                 auto res = sendto(server->udp_socket.get_fd(), &connection_addr, sizeof connection_addr, 0, (const sockaddr *)(&broadcast), sizeof broadcast);
-                auto err = errno;
                 if (res == -1) {
                     server->console->push_message("[ERROR]: Failed to send connection details");
                 }
@@ -186,33 +322,543 @@ namespace ClientServerChatApp {
             }
         }};
         while(!server->console->shutdown.load()) {
-            server->run_loop_timeout(2);
+            auto wait_ms = server->next_wait_ms();
+            server->run_loop_timeout(wait_ms / 1000, (wait_ms % 1000) * 1000);
         }
-        udp_broadcaster.join();
+        if (udp_broadcaster.joinable()) udp_broadcaster.join();
     }
 
-    void Server::broadcast(const std::string& message) {
-        for (const auto& client : _client_sockets) {
-            client->full_send(message, {});
+    void Server::broadcast(const EncodedMessage& message) {
+        deliver(message);
+        for (const auto& peer : shards->servers) {
+            if (peer.get() != this) peer->post(message);
         }
     }
 
-    void Server::run_loop(struct timeval* timeout) {
-        FD_ZERO(&_read_fds);
-        set_to_fds(_read_fds);
-        int max_sd = _fd;
-        for (const auto & _client_socket : _client_sockets) {
-            if (_client_socket->get_fd() > 0) _client_socket->set_to_fds(_read_fds);
-            if (_client_socket->get_fd() > max_sd) max_sd = _client_socket->get_fd();
+    LibSocket::SharedFrame Server::make_frame(const std::string& message) {
+        return std::make_shared<const std::string>(Socket::encode(message));
+    }
+
+    void Server::post(const EncodedMessage& message) {
+        bool was_empty;
+        {
+            UniqueLock lock{_inbox_mtx};
+            was_empty = _inbox.empty() && _job_chunks.empty();
+            _inbox.push_back(message);
+        }
+        // an inbox that already had messages has a wakeup on the way
+        if (was_empty) waker.notify();
+    }
+
+    void Server::post(JobChunk chunk) {
+        bool was_empty;
+        {
+            UniqueLock lock{_inbox_mtx};
+            was_empty = _inbox.empty() && _job_chunks.empty();
+            _job_chunks.push_back(std::move(chunk));
+        }
+        if (was_empty) waker.notify();
+    }
+
+    void Server::drain_inbox() {
+        // reset the waker first so anything posted after this point produces a new wakeup
+        waker.drain();
+        std::vector<EncodedMessage> messages;
+        std::vector<JobChunk> chunks;
+        {
+            UniqueLock lock{_inbox_mtx};
+            messages.swap(_inbox);
+            chunks.swap(_job_chunks);
+        }
+        for (const auto& message : messages) deliver(message);
+        for (const auto& chunk : chunks) finish_chunk(chunk);
+    }
+
+    void Server::start_job(Connection& connection, Protocol::Opcode command, std::string_view argument) {
+        auto refuse = [&](std::string_view reason) {
+            enqueue(connection, frame_for(connection, Protocol::Notice{reason}));
+            // ends the client's wait for the answer
+            enqueue(connection, frame_for(connection, Protocol::DoneSend{}));
+        };
+        if (connection.job) {
+            refuse("[ERROR]: Your last request is still being answered, try again when it's done");
+            return;
+        }
+        if (shards->jobs.fetch_add(1) >= shards->max_jobs) {
+            shards->jobs.fetch_sub(1);
+            refuse("[ERROR]: The server is busy, try again in a moment");
+            return;
+        }
+        BackgroundJob job{.command = command, .binary = connection.binary};
+        if (command == Protocol::Opcode::GET_LOG) {
+            auto page = Protocol::parse_log_page(argument);
+            if (!page) {
+                shards->jobs.fetch_sub(1);
+                refuse("[ERROR]: Usage: $getlog [from] [count], from counts lines from 1, or back from the end if negative");
+                return;
+            }
+            job.page = *page;
+            // the log is only appended to and lines are written whole, everything before this size stays as it is
+            std::tie(job.log_path, job.log_size) = Utilities::log_extent();
+        }
+        connection.job = std::move(job);
+        submit_job(connection);
+    }
+
+    void Server::submit_job(Connection& connection) {
+        connection.job->parked = false;
+        shards->workers.submit([this, key = connection.key, job = *connection.job] { run_job(key, job); });
+    }
+
+    void Server::resume_job(Connection& connection) {
+        if (!connection.job || !connection.job->parked) return;
+        const auto& outbound = connection.outbound;
+        // the next chunk has to fit next to what's queued, otherwise the client reads some of it first
+        if (!outbound.empty() && (outbound.pending_bytes() + job_chunk_bytes > max_outbound_bytes
+                                  || outbound.size() + job_chunk_frames >= max_outbound_frames)) return;
+        submit_job(connection);
+    }
+
+    void Server::end_job(Connection& connection) {
+        connection.job.reset();
+        shards->jobs.fetch_sub(1);
+    }
+
+    void Server::run_job(Utilities::SlotKey key, const BackgroundJob& job) {
+        JobChunk chunk{key, {}, job.offset, job.end, true};
+        if (job.command == Protocol::Opcode::GET_LIST) {
+            for (const auto& shard : shards->servers) {
+                for (const auto& username : shard->usernames()) chunk.frames.push_back(frame_as(job.binary, Protocol::Entry{username}));
+            }
+        } else if (auto mapping = shards->log_view.map(job.log_path, job.log_size)) {
+            if (!job.located) std::tie(chunk.offset, chunk.end) = shards->log_view.locate(*mapping, job.log_size, job.page.from, job.page.count);
+            auto data = mapping->data();
+            size_t bytes = 0;
+            while (chunk.offset < chunk.end && bytes < job_chunk_bytes && chunk.frames.size() < job_chunk_frames) {
+                auto newline = (const char*)std::memchr(data + chunk.offset, '\n', chunk.end - chunk.offset);
+                auto line_end = newline != nullptr ? (size_t)(newline - data) : chunk.end;
+                chunk.frames.push_back(frame_as(job.binary, Protocol::Entry{std::string_view{data + chunk.offset, line_end - chunk.offset}}));
+                bytes += chunk.frames.back()->size();
+                chunk.offset = line_end + 1;
+            }
+            chunk.done = chunk.offset >= chunk.end;
+        }
+        if (chunk.done) chunk.frames.push_back(frame_as(job.binary, Protocol::DoneSend{}));
+        post(std::move(chunk));
+    }
+
+    void Server::finish_chunk(const JobChunk& chunk) {
+        auto found = _connections.get(chunk.connection);
+        if (found == nullptr) {
+            // the client is gone and so is its record
+            shards->jobs.fetch_sub(1);
+            return;
+        }
+        for (const auto& frame : chunk.frames) {
+            if (found->state == ConnectionState::CLOSING) break;
+            enqueue(*found, frame);
+        }
+        if (found->state == ConnectionState::CLOSING || chunk.done) {
+            end_job(*found);
+            return;
+        }
+        found->job->offset = chunk.offset;
+        found->job->end = chunk.end;
+        found->job->located = true;
+        found->job->parked = true;
+        resume_job(*found);
+    }
+
+    void Server::deliver(const EncodedMessage& message) {
+        bool outermost = !_delivering;
+        _delivering = true;
+        if (message.text->size() <= max_history_frame) _history.push(message);
+        for (auto& connection : _connections) {
+            // chat traffic, a client that falls behind may lose some of it
+            if (connection.state == ConnectionState::CLOSING) continue;
+            enqueue(connection, connection.binary ? message.binary : message.text, true);
+        }
+        // the notices go out after the message that caused them, for every client and in _history. Their own
+        // deliver is nested and only adds to _drop_notices, so this loop picks up whoever they drop in turn
+        if (!outermost) return;
+        while (!_drop_notices.empty()) {
+            auto notices = std::move(_drop_notices);
+            _drop_notices.clear();
+            for (const auto& notice : notices) broadcast(Protocol::Notice{notice});
+        }
+        _delivering = false;
+    }
+
+    void Server::enqueue(Connection& connection, const LibSocket::SharedFrame& frame, bool droppable) {
+        if (!make_room(connection, frame->size())) return;
+        if (backend == IOBackend::IO_URING) {
+            connection.outbound.push(frame, droppable);
+            if (!connection.sending) ring_prepare_send(connection);
+            track_send(connection, false);
+            return;
+        }
+        bool idle = connection.outbound.empty();
+        connection.outbound.push(frame, droppable);
+        // a non-empty queue is already waiting on a writable event, keep the frame order
+        if (idle) flush(connection);
+    }
+
+    void Server::enqueue(Connection& connection, const std::vector<LibSocket::SharedFrame>& frames, bool droppable) {
+        if (frames.empty()) return;
+        bool idle = connection.outbound.empty();
+        for (const auto& frame : frames) {
+            if (!make_room(connection, frame->size())) return;
+            connection.outbound.push(frame, droppable);
+        }
+        if (backend == IOBackend::IO_URING) {
+            if (!connection.sending) ring_prepare_send(connection);
+            track_send(connection, false);
+            return;
         }
-        select(max_sd, timeout);
-        if (fds_is_set(_read_fds)) accept(nullptr, nullptr);
+        if (idle) flush(connection);
+    }
+
+    std::vector<LibSocket::SharedFrame> Server::history_for(const Connection& connection) const {
+        std::vector<LibSocket::SharedFrame> frames;
+        frames.reserve(_history.size());
+        _history.for_each([&](const EncodedMessage& message) { frames.push_back(connection.binary ? message.binary : message.text); });
+        return frames;
+    }
 
-        for (size_t i = 0; i < _client_sockets.size(); ++i) {
-            if (_client_sockets[i]->fds_is_set(_read_fds)) { // client has sent something
-                _client_sockets[i]->receive_str({});
+    bool Server::make_room(Connection& connection, size_t bytes) {
+        auto& outbound = connection.outbound;
+        if (outbound.pending_bytes() + bytes <= max_outbound_bytes && outbound.size() < max_outbound_frames) return true;
+        auto& counters = shards->slow_clients;
+        if (slow_client_policy != SlowClientPolicy::DISCONNECT) {
+            // what stays queued has to leave room for the new frame
+            auto byte_room = max_outbound_bytes > bytes ? max_outbound_bytes - bytes : 0;
+            auto frame_room = max_outbound_frames > 0 ? max_outbound_frames - 1 : 0;
+            size_t dropped;
+            // the notice stands in for frames that were dropped, it doesn't count against the caps
+            size_t notice_bytes = 0;
+            if (slow_client_policy == SlowClientPolicy::COALESCE) {
+                dropped = outbound.shed(byte_room, frame_room, connection.sending, [&connection, &notice_bytes](size_t skipped) {
+                    auto text = "[INFO]: " + std::to_string(skipped) + " messages skipped, you fell too far behind.";
+                    auto notice = frame_for(connection, Protocol::Notice{text});
+                    notice_bytes = notice->size();
+                    return notice;
+                });
+                if (dropped > 0) counters.coalesced.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                dropped = outbound.shed(byte_room, frame_room, connection.sending);
+                if (dropped > 0) counters.dropped.fetch_add(1, std::memory_order_relaxed);
             }
+            counters.frames_dropped.fetch_add(dropped, std::memory_order_relaxed);
+            // the new frame may go over on its own, what was already queued may not
+            auto queued_bytes = outbound.pending_bytes() - notice_bytes;
+            auto queued_frames = outbound.size() - (notice_bytes > 0 ? 1 : 0);
+            if (queued_bytes <= max_outbound_bytes && queued_frames < max_outbound_frames) return true;
         }
+        counters.disconnected.fetch_add(1, std::memory_order_relaxed);
+        // nothing else will be sent, the signal can go out right away unless it would land inside another frame
+        bool mid_frame = connection.sending || outbound.front_started();
+        outbound.clear();
+        if (!mid_frame) {
+            static const LibSocket::SharedFrame too_slow_text = make_frame(Protocol::to_text(Protocol::TooSlow{}));
+            static const LibSocket::SharedFrame too_slow_binary = make_frame(Protocol::encode_binary(Protocol::TooSlow{}));
+            const auto& too_slow = connection.binary ? too_slow_binary : too_slow_text;
+            connection.socket->send(too_slow->data(), too_slow->size(), {LibSocket::SocketSendFlags::DONT_WAIT, LibSocket::SocketSendFlags::NO_SIGNAL});
+        }
+        drop(connection, " fell too far behind and was disconnected.");
+        return false;
+    }
+
+    void Server::drop(Connection& connection, const std::string& reason) {
+        std::string username = connection.username;
+        disconnect(connection.socket.get());
+        std::string msg = "[INFO]: " + (username.empty() ? std::string{"A client"} : username) + reason;
+        console->push_message(msg);
+        Utilities::log(msg);
+        if (username.empty()) return;
+        if (_delivering) _drop_notices.push_back(std::move(msg));
+        else broadcast(Protocol::Notice{msg});
+    }
+
+    void Server::flush(Connection& connection) {
+        auto pending = connection.outbound.pending_bytes();
+        connection.outbound.flush(connection.fd, connection.socket->send_handlers);
+        track_send(connection, connection.outbound.pending_bytes() < pending);
+    }
+
+    void Server::track_send(Connection& connection, bool progressed) {
+        resume_job(connection);
+        if (connection.outbound.empty()) {
+            _timers.cancel(connection.send_timer);
+            connection.send_timer = {};
+            return;
+        }
+        if (send_timeout.count() == 0) return;
+        if (connection.send_timer == Utilities::SlotKey{}) {
+            connection.last_send = _now;
+            connection.send_timer = _timers.arm(send_timeout, timer_tag(TimerKind::SEND, connection.key));
+        } else if (progressed) {
+            // the timer isn't moved, it compares against last_send when it fires
+            connection.last_send = _now;
+        }
+    }
+
+    void Server::run_timers() {
+        _now = Clock::now();
+        _timers.advance(_now, [this](uint64_t tag) { expire(tag); });
+    }
+
+    int Server::next_wait_ms() {
+        auto wait_ms = _timers.next_timeout_ms(Clock::now());
+        return wait_ms < 0 ? shutdown_poll_ms : std::min(wait_ms, shutdown_poll_ms);
+    }
+
+    void Server::expire(uint64_t tag) {
+        auto found = _connections.get(tag_key(tag));
+        if (found == nullptr || found->state == ConnectionState::CLOSING) return;
+        std::string reason;
+        if (timer_kind(tag) == TimerKind::SEND) {
+            found->send_timer = {};
+            auto stalled = _now - found->last_send;
+            if (stalled < send_timeout) {
+                found->send_timer = _timers.arm(send_timeout - stalled, tag);
+                return;
+            }
+            reason = " stopped reading messages and was disconnected.";
+        } else {
+            found->idle_timer = {};
+            auto quiet = _now - found->last_receive;
+            if (quiet < idle_timeout) {
+                auto interval = heartbeat_interval();
+                if (quiet < interval) {
+                    found->idle_timer = _timers.arm(interval - quiet, tag);
+                    return;
+                }
+                // an empty frame, clients answer it with one of their own
+                static const LibSocket::SharedFrame heartbeat = make_frame("");
+                enqueue(*found, heartbeat);
+                found->idle_timer = _timers.arm(interval, tag);
+                return;
+            }
+            reason = " timed out.";
+        }
+        drop(*found, reason);
+    }
+
+    Server::Connection* Server::connection(SocketFileDescriptor fd) {
+        if (fd < 0 || (size_t)fd >= _by_fd.size()) return nullptr;
+        return _connections.get(_by_fd[fd]);
+    }
+
+    void Server::watch(std::shared_ptr<Socket> client) {
+        auto fd = client->get_fd();
+        Utilities::SlotKey key;
+        {
+            UniqueLock lock{_connections_mtx};
+            key = _connections.emplace();
+        }
+        auto& connection = *_connections.get(key);
+        connection.socket = std::move(client);
+        connection.fd = fd;
+        connection.key = key;
+        if ((size_t)fd >= _by_fd.size()) _by_fd.resize(fd + 1);
+        _by_fd[fd] = key;
+        connection.last_receive = _now;
+        if (idle_timeout.count() > 0) connection.idle_timer = _timers.arm(heartbeat_interval(), timer_tag(TimerKind::IDLE, key));
+        if (backend == IOBackend::IO_URING) {
+            ring_prepare_recv(connection);
+            return;
+        }
+        // accept_pending already hands out non-blocking clients where accept4 exists
+        if (!connection.socket->is_non_blocking()) connection.socket->set_non_blocking(true);
+        if (zerocopy && !connection.outbound.enable_zerocopy(fd, zerocopy_threshold)) {
+            std::string msg = "[WARNING]: MSG_ZEROCOPY is unavailable, sends will be copied.";
+            zerocopy = false;
+            console->push_message(msg);
+            Utilities::log(msg);
+        }
+        // registered for both directions once, edge-triggered writes only report when a full socket drains
+        reactor.add(fd, {
+            LibSocket::ReactorInterest::READ,
+            LibSocket::ReactorInterest::WRITE,
+            LibSocket::ReactorInterest::EDGE_TRIGGERED
+        });
+    }
+
+    void Server::disconnect(Socket* client) {
+        auto found = connection(client->get_fd());
+        if (found == nullptr || found->state == ConnectionState::CLOSING) return;
+        {
+            UniqueLock lock{_connections_mtx};
+            found->state = ConnectionState::CLOSING;
+            found->username.clear();
+        }
+        shards->connected.fetch_sub(1);
+        // a chunk on a worker ends the job when it comes back, a parked job has nothing coming back
+        if (found->job && found->job->parked) end_job(*found);
+        _timers.cancel(found->idle_timer);
+        _timers.cancel(found->send_timer);
+        if (backend == IOBackend::IO_URING) {
+            // completes the pending recv right away, the record is freed once it's back
+            ::shutdown(found->fd, SHUT_RDWR);
+        } else {
+            reactor.remove(found->fd);
+        }
+        _closing.push_back(found->key);
+    }
+
+    void Server::reap() {
+        if (_closing.empty()) return;
+        std::vector<Utilities::SlotKey> waiting;
+        for (auto key : _closing) {
+            auto found = _connections.get(key);
+            if (found == nullptr) continue;
+            // the kernel still owns the socket's read buffer, or a send for it is queued or in flight and
+            // would go to whoever gets the fd number next. shutdown in disconnect makes both finish soon
+            if (found->receiving || found->sending) {
+                waiting.push_back(key);
+                continue;
+            }
+            _by_fd[found->fd] = {};
+            // the socket closes with the record, after this the fd can be handed out again
+            UniqueLock lock{_connections_mtx};
+            _connections.erase(key);
+        }
+        _closing.swap(waiting);
+    }
+
+    std::vector<std::string> Server::usernames() {
+        std::vector<std::string> names;
+        UniqueLock lock{_connections_mtx};
+        for (const auto& connection : _connections) {
+            if (connection.state == ConnectionState::REGISTERED) names.push_back(connection.username);
+        }
+        return names;
+    }
+
+    void Server::ring_prepare_recv(Connection& connection) {
+        auto [buffer, length] = connection.socket->read_buffer_space();
+        ring.prepare_recv(connection.fd, buffer, length, ring_tag(RingOp::RECV, connection.key));
+        connection.receiving = true;
+    }
+
+    void Server::ring_prepare_send(Connection& connection) {
+        auto [buffer, length] = connection.outbound.front();
+        auto tag = ring_tag(RingOp::SEND, connection.key);
+        _ring_sends_in_flight[tag] = connection.outbound.front_frame();
+        ring.prepare_send(connection.fd, buffer, length, tag);
+        connection.sending = true;
+    }
+
+    void Server::run_ring_loop(int timeout_ms) {
+        // everything prepared since the last iteration goes to the kernel in this one call
+        const auto& completions = ring.submit_and_wait(timeout_ms);
+        run_timers();
+        for (const auto& completion : completions) {
+            // nullptr once the connection is gone, a reused slot has a different generation
+            auto found = _connections.get(tag_key(completion.user_data));
+            switch (ring_op(completion.user_data)) {
+                case RingOp::WAKE: {
+                    drain_inbox();
+                    // polls are one-shot
+                    ring.prepare_poll(waker.read_fd(), completion.user_data);
+                    break;
+                }
+                case RingOp::ACCEPT: {
+                    // keep the same number of accepts in flight
+                    ring.prepare_accept(_fd, completion.user_data);
+                    if (completion.result < 0) {
+                        accept_handlers.dispatch(true, -completion.result, nullptr);
+                        break;
+                    }
+                    std::shared_ptr<Socket> client = std::make_shared<Socket>();
+                    client->_fd = completion.result;
+                    accept_handlers.run(LibSocket::SocketAcceptError::SUCCESS, client);
+                    break;
+                }
+                case RingOp::RECV: {
+                    if (found == nullptr) break;
+                    found->receiving = false;
+                    if (found->state == ConnectionState::CLOSING) break;
+                    Socket* client = found->socket.get();
+                    if (completion.result > 0) {
+                        found->last_receive = _now;
+                        client->receive_buffered(completion.result);
+                        // handlers don't add or free records, but they may have closed this one
+                        if (found->state != ConnectionState::CLOSING) ring_prepare_recv(*found);
+                    } else if (completion.result == 0) {
+                        client->receive_handlers.run(LibSocket::SocketReceiveError::DISCONNECTING, "", client);
+                    } else {
+                        client->receive_handlers.dispatch(true, -completion.result, "", client);
+                    }
+                    break;
+                }
+                case RingOp::SEND: {
+                    // the frame is released at the end of this scope unless the queue still holds it
+                    auto in_flight = _ring_sends_in_flight.extract(completion.user_data);
+                    static const std::string no_payload{};
+                    const std::string& payload = in_flight.empty() ? no_payload : *in_flight.mapped();
+                    if (completion.result < 0 && found != nullptr && found->state == ConnectionState::CLOSING) {
+                        // cut short by the shutdown in disconnect, the record can go now
+                        found->sending = false;
+                        break;
+                    }
+                    if (completion.result < 0) {
+                        send_handlers.dispatch(true, -completion.result, payload);
+                        if (found == nullptr) break;
+                        // the connection is unusable, don't keep feeding it
+                        found->sending = false;
+                        found->outbound.clear();
+                        disconnect(found->socket.get());
+                        break;
+                    }
+                    send_handlers.run(LibSocket::SocketSendError::SUCCESS, payload);
+                    if (found == nullptr) break;
+                    found->sending = false;
+                    if (found->state == ConnectionState::CLOSING) break;
+                    // a short send resumes from where the kernel stopped
+                    found->outbound.consume(completion.result);
+                    if (!found->outbound.empty()) ring_prepare_send(*found);
+                    track_send(*found, completion.result > 0);
+                    break;
+                }
+            }
+        }
+        reap();
+    }
+
+    void Server::run_loop(struct timeval* timeout) {
+        int timeout_ms = timeout == nullptr ? -1 : (int)(timeout->tv_sec * 1000 + timeout->tv_usec / 1000);
+        if (backend == IOBackend::IO_URING) {
+            run_ring_loop(timeout_ms);
+            return;
+        }
+        // only sockets that actually became ready come back from the reactor
+        const auto& events = reactor.wait(timeout_ms);
+        run_timers();
+        for (const auto& event : events) {
+            if (event.fd == _fd) {
+                accept_pending();
+                continue;
+            }
+            if (event.fd == waker.read_fd()) {
+                drain_inbox();
+                continue;
+            }
+            auto found = connection(event.fd);
+            // a record only goes away in reap, so found stays valid while its handlers run
+            if (found == nullptr || found->state == ConnectionState::CLOSING) continue;
+            Socket* client = found->socket.get();
+            // zerocopy completions are reported as an error condition on the socket
+            if (event.hang_up) found->outbound.reclaim(event.fd);
+            // room opened up in the kernel buffer, continue where the last flush stopped
+            if (event.writable) flush(*found);
+            if (!event.readable) continue;
+            found->last_receive = _now;
+            // edge-triggered so keep reading until the kernel buffer is empty, a frame split across
+            // reads stays buffered in the socket until the rest arrives
+            while (found->state != ConnectionState::CLOSING && client->receive_frames({}) > 0) {}
+        }
+        reap();
     }
     void Server::run_loop_timeout() { run_loop(nullptr); }
     void Server::run_loop_timeout(size_t seconds, size_t microseconds) {
@@ -222,9 +868,22 @@ namespace ClientServerChatApp {
         run_loop(&timeout);
     }
 
-    Server::Server(SmartConsole::Console *_console): LibSocket::ServerSocket<SocketSizeType>(), console(_console), udp_socket() {}
+    Server::Server(SmartConsole::Console *_console, ServerShards* _shards, size_t _shard_id):
+        LibSocket::ServerSocket<SocketSizeType>(), udp_socket(), console(_console), shards(_shards), shard_id(_shard_id) {}
 
     std::thread Server::initialize_server(const std::string& port, const std::string& ip) {
         return std::thread{run_server, this, port, ip};
     }
+
+    ServerShards::ServerShards(SmartConsole::Console* console, size_t count, size_t worker_count): workers(worker_count) {
+        for (size_t i = 0; i < std::max<size_t>(count, 1); ++i) {
+            servers.push_back(std::make_unique<Server>(console, this, i));
+        }
+    }
+
+    std::vector<std::thread> ServerShards::initialize_servers(const std::string& port, const std::string& ip) {
+        std::vector<std::thread> threads;
+        for (const auto& server : servers) threads.push_back(server->initialize_server(port, ip));
+        return threads;
+    }
 } // ClientServerChatApp
\ No newline at end of file
@@ -6,14 +6,42 @@
 #define CLIENTSERVERCHATAPP_SERVER_H
 
 #include "Console.h"
+#include "HistoryRing.h"
+#include "LogView.h"
+#include "Protocol.h"
+#include "SlotMap.h"
+#include "TimerWheel.h"
+#include "WorkerPool.h"
 
 namespace ClientServerChatApp {
+    /**
+     * How the server waits for and performs socket I/O
+     */
+    enum class IOBackend {
+        /// epoll/kqueue readiness, one send/recv syscall per frame
+        REACTOR,
+        /// io_uring, accepts, receives and sends are submitted and harvested in batches (Linux only)
+        IO_URING
+    };
+    /**
+     * What happens to a client whose outbound queue reaches max_outbound_bytes or max_outbound_frames
+     */
+    enum class SlowClientPolicy {
+        /// Drop the oldest queued chat messages to make room
+        DROP_OLDEST,
+        /// Drop the oldest queued chat messages and put a "N messages skipped" notice in their place
+        COALESCE,
+        /// Disconnect the client, telling it why (SRV_TOO_SLOW) if that still fits in its socket
+        DISCONNECT
+    };
+    class ServerShards;
     /**
      * Server object encapsulating the low level functionality of working with sockets
      */
     class Server: public LibSocket::ServerSocket<SocketSizeType> {
     private:
         using Socket = LibSocket::Socket<SocketSizeType>;
+        using Clock = Utilities::TimerWheel::Clock;
         /**
          * Function created when running the server thread
          * @param server Pointer to server object
@@ -21,7 +49,265 @@ namespace ClientServerChatApp {
          */
         static void run_server(Server* server, std::string port, std::string ip);
 
-        std::vector<std::shared_ptr<Socket>> _client_sockets;
+        /// Where a connection is in its life
+        enum class ConnectionState {
+            /// Accepted, can only $register
+            CONNECTED,
+            /// Has a username and takes part in the chat
+            REGISTERED,
+            /// Removed from the chat, the record goes away once no I/O refers to it anymore (see reap)
+            CLOSING
+        };
+        /// A command answered by a worker thread instead of the event loop, a chunk at a time
+        struct BackgroundJob {
+            /// GET_LOG or GET_LIST
+            Protocol::Opcode command;
+            /// Encode the answer for the binary protocol
+            bool binary;
+            /// Log file being read and its size when the command came in, lines logged later aren't sent
+            std::string log_path{};
+            size_t log_size{0};
+            /// Lines asked for, turned into the byte range below by the first chunk so the index is built off the loop
+            Protocol::LogPage page{};
+            bool located{false};
+            /// Where the next chunk starts and the page ends, in bytes of the log
+            size_t offset{0};
+            size_t end{0};
+            /// Waiting for the client to read what's queued before the next chunk is read (see resume_job)
+            bool parked{false};
+        };
+        /// What a worker produced for a BackgroundJob, handed to the connection's shard through its inbox
+        struct JobChunk {
+            Utilities::SlotKey connection;
+            std::vector<LibSocket::SharedFrame> frames;
+            /// Where the chunk after this one starts and the page ends
+            size_t offset;
+            size_t end;
+            /// frames ends with DONE_SEND and the job is over
+            bool done;
+        };
+        /// Everything the server keeps for one client
+        struct Connection {
+            std::shared_ptr<Socket> socket;
+            SocketFileDescriptor fd;
+            /// This record's own key, goes into io_uring requests so a completion can find it again
+            Utilities::SlotKey key;
+            ConnectionState state{ConnectionState::CONNECTED};
+            /// Set when REGISTERED
+            std::string username;
+            /// Negotiated the binary protocol (see Protocol), everything sent to the client is encoded for it
+            bool binary{false};
+            /// Frames still to be sent. REACTOR drains it whenever the socket is writable, IO_URING keeps the
+            /// front frame in flight while sending is true
+            LibSocket::OutboundQueue outbound;
+            bool sending{false};
+            /// A recv into the socket's read buffer is in flight (IO_URING), the record can't be freed yet
+            bool receiving{false};
+            /// When bytes last arrived from the client, silence is measured from here
+            Clock::time_point last_receive;
+            /// When the kernel last took bytes from outbound, or when outbound stopped being empty
+            Clock::time_point last_send;
+            /// Pings the client once it goes quiet and drops it if it stays quiet, see idle_timeout
+            Utilities::SlotKey idle_timer;
+            /// Armed while outbound isn't empty, drops a client that stopped reading, see send_timeout
+            Utilities::SlotKey send_timer;
+            /// Command being answered off the loop, one per client so answers never interleave
+            std::optional<BackgroundJob> job;
+        };
+        /// This shard's clients. Only the owning thread changes it, inserts and erases hold _connections_mtx
+        Utilities::SlotMap<Connection> _connections;
+        /// Guards membership and usernames of _connections against other shards reading them (usernames())
+        std::mutex _connections_mtx;
+        /// Key of the connection using each file descriptor, fds are small so a vector indexed by fd is enough
+        std::vector<Utilities::SlotKey> _by_fd;
+        /// Connections marked CLOSING that reap hasn't freed yet
+        std::vector<Utilities::SlotKey> _closing;
+        /**
+         * Finds the connection of a file descriptor
+         * @param fd client socket
+         * @return the record, nullptr if fd isn't a client of this shard
+         */
+        Connection* connection(SocketFileDescriptor fd);
+        /**
+         * Takes a client out of the chat. Its record stays until reap() so handlers further up the stack can
+         * keep using the socket, and so an in-flight io_uring recv never writes into a freed buffer.
+         * @param client socket of the client
+         */
+        void disconnect(Socket* client);
+        /// Frees every CLOSING connection nothing refers to anymore, called at the end of each loop iteration
+        void reap();
+
+        /// Length of a tick of _timers, how precisely timeouts are kept
+        static constexpr std::chrono::milliseconds timer_resolution{10};
+        /// Longest the loop sleeps without a timer due, the shutdown flag is only checked between iterations
+        static constexpr int shutdown_poll_ms = 2000;
+        /// Heartbeat, idle and send deadlines of every connection
+        Utilities::TimerWheel _timers{timer_resolution};
+        /// Time the loop woke up at, read once per iteration
+        Clock::time_point _now;
+        /// Fires every timer that came due while the loop was waiting
+        void run_timers();
+        /**
+         * Handles a timer of a connection
+         * @param tag payload the timer was armed with
+         */
+        void expire(uint64_t tag);
+        /// How long the loop can wait before a timer is due
+        int next_wait_ms();
+        /// A client quiet for this long is pinged, a third of idle_timeout so it gets a few chances to answer
+        Clock::duration heartbeat_interval() const { return std::chrono::duration_cast<Clock::duration>(idle_timeout) / 3; }
+        /**
+         * Keeps the send deadline of a connection up to date after its outbound queue changed
+         * @param connection whose queue changed
+         * @param progressed whether the kernel took any bytes
+         */
+        void track_send(Connection& connection, bool progressed);
+        /// Writes as much of a connection's outbound queue as the socket takes (REACTOR)
+        void flush(Connection& connection);
+        /**
+         * Applies slow_client_policy if a frame doesn't fit in a connection's outbound queue
+         * @param connection recipient
+         * @param bytes size of the frame
+         * @return false if the connection was disconnected instead
+         */
+        bool make_room(Connection& connection, size_t bytes);
+        /// Most bytes of frames a worker produces per chunk of a BackgroundJob
+        static constexpr size_t job_chunk_bytes = 64 * 1024;
+        /// Most frames a worker produces per chunk of a BackgroundJob
+        static constexpr size_t job_chunk_frames = 256;
+        /**
+         * Answers $getlog or $getlist on the worker pool, or tells the client to try again if the per-client or
+         * global limit is reached
+         * @param connection requester
+         * @param command GET_LOG or GET_LIST
+         * @param argument page of the log for GET_LOG (see Protocol::parse_log_page)
+         */
+        void start_job(Connection& connection, Protocol::Opcode command, std::string_view argument);
+        /// Hands the next chunk of a connection's job to the worker pool
+        void submit_job(Connection& connection);
+        /// Submits the next chunk of a parked job once the client's queue has room for it
+        void resume_job(Connection& connection);
+        /// Forgets a connection's job and releases its place under the global limit
+        void end_job(Connection& connection);
+        /**
+         * Produces one chunk of a job, runs on a worker thread
+         * @param key connection the job is for
+         * @param job copy of the job as it was submitted
+         */
+        void run_job(Utilities::SlotKey key, const BackgroundJob& job);
+        /// Queues a chunk a worker produced and submits the next one or ends the job
+        void finish_chunk(const JobChunk& chunk);
+        /**
+         * Disconnects a client the server gave up on and tells everyone else
+         * @param connection the client
+         * @param reason end of the announcement, after the username
+         */
+        void drop(Connection& connection, const std::string& reason);
+        /// Set while deliver walks _connections, drop leaves its announcement in _drop_notices instead of broadcasting
+        bool _delivering{false};
+        /// Announcements of clients dropped during a deliver, broadcast once it has queued the message for everyone
+        std::vector<std::string> _drop_notices;
+
+        /**
+         * Handlers every accepted client runs, built once by run_server. Assigning them to a socket shares the tables
+         * instead of copying them, so a connection costs the same no matter how many errors are handled.
+         */
+        struct ClientProtocol {
+            decltype(Socket::receive_handlers) receive;
+            decltype(Socket::fcntl_handlers) fcntl;
+        } _client_protocol;
+
+        /// Readiness notifications for the listening socket and every client, sockets register once
+        LibSocket::Reactor reactor;
+
+        /// Submission/completion rings used instead of the reactor by the IO_URING backend
+        LibSocket::IoUring ring;
+        /// Frames the kernel is still reading from, kept alive until their completion even if the client left
+        std::unordered_map<uint64_t, LibSocket::SharedFrame> _ring_sends_in_flight;
+        /// Queues the receive for a client's next bytes
+        void ring_prepare_recv(Connection& connection);
+        /// Queues the send of the front frame of a client's outbound queue
+        void ring_prepare_send(Connection& connection);
+        /// Completion processing for the IO_URING backend
+        void run_ring_loop(int timeout_ms);
+        /// Wakes this shard's loop when another shard posts to the inbox
+        LibSocket::ReactorWaker waker;
+        /// A broadcast framed once per protocol, every recipient references one of the two
+        struct EncodedMessage {
+            LibSocket::SharedFrame text;
+            LibSocket::SharedFrame binary;
+        };
+        /// Broadcasts made by other shards waiting to be delivered to this shard's clients
+        std::vector<EncodedMessage> _inbox;
+        /// Chunks workers produced for this shard's clients, guarded by _inbox_mtx as well
+        std::vector<JobChunk> _job_chunks;
+        std::mutex _inbox_mtx;
+        /**
+         * Hands a broadcast from another shard's thread to this shard
+         * @param message the same frames every shard's clients are sent
+         */
+        void post(const EncodedMessage& message);
+        /// Hands a chunk from a worker thread to this shard
+        void post(JobChunk chunk);
+        /// Delivers everything other shards and workers posted since the last drain
+        void drain_inbox();
+        /// Queues a broadcast for every client connected to this shard, in the protocol each one speaks
+        void deliver(const EncodedMessage& message);
+        /**
+         * The last history_size broadcasts, replayed to a client when it registers. Every shard delivers every
+         * broadcast, so each keeps its own in the order its clients saw it and no lock is needed
+         */
+        Utilities::HistoryRing<EncodedMessage> _history;
+        /// Larger broadcasts aren't kept in _history, a handful of them would hold on to megabytes
+        static constexpr size_t max_history_frame = 64 * 1024;
+        /**
+         * Frames of _history in the protocol a client speaks, oldest first
+         * @param connection recipient
+         */
+        std::vector<LibSocket::SharedFrame> history_for(const Connection& connection) const;
+        /// Sends a message, framed for both protocols, to every client of every shard
+        void broadcast(const EncodedMessage& message);
+        /**
+         * Encodes a message once so any number of queues can reference it
+         * @param message payload
+         * @return size header and payload, shared and immutable
+         */
+        static LibSocket::SharedFrame make_frame(const std::string& message);
+        /**
+         * Frames a message in the protocol a client speaks
+         * @param connection recipient
+         * @param message one of the Protocol messages
+         */
+        template<typename Message>
+        static LibSocket::SharedFrame frame_for(const Connection& connection, const Message& message) {
+            return frame_as(connection.binary, message);
+        }
+        /**
+         * Frames a message in either protocol
+         * @param binary encode for the binary protocol instead of text
+         * @param message one of the Protocol messages
+         */
+        template<typename Message>
+        static LibSocket::SharedFrame frame_as(bool binary, const Message& message) {
+            return make_frame(binary ? Protocol::encode_binary(message) : Protocol::to_text(message));
+        }
+        /**
+         * Queues an encoded frame for a client and starts writing it if nothing else is in flight
+         * @param connection recipient
+         * @param frame bytes exactly as they should appear on the wire
+         * @param droppable chat traffic slow_client_policy may drop, replies to the client itself aren't
+         */
+        void enqueue(Connection& connection, const LibSocket::SharedFrame& frame, bool droppable = false);
+        /**
+         * Queues several frames and starts writing once they're all queued, so they go out together
+         * (REACTOR gathers them into as few sendmsg calls as it takes)
+         * @param connection recipient
+         * @param frames in the order they're sent
+         * @param droppable chat traffic slow_client_policy may drop
+         */
+        void enqueue(Connection& connection, const std::vector<LibSocket::SharedFrame>& frames, bool droppable = false);
+        /// Adds a newly accepted client and begins delivering its events
+        void watch(std::shared_ptr<Socket> client);
 
         LibSocket::ServerSocket<SocketSizeType> udp_socket;
     public:
@@ -30,23 +316,121 @@ namespace ClientServerChatApp {
         /// Child thread sends Socket connection successful, main receives it
         SyncPoint<bool> sync_socket_established;
         SmartConsole::Console* console;
+        /// Group this server is a shard of
+        ServerShards* shards;
+        /// Index of this server within shards
+        size_t shard_id;
+        /// Selected before initialize_server, falls back to REACTOR if io_uring is unavailable
+        IOBackend backend{IOBackend::REACTOR};
+        /// Send large writes with MSG_ZEROCOPY (REACTOR backend, Linux only), set before initialize_server
+        bool zerocopy{false};
+        /// Smallest write that uses MSG_ZEROCOPY, below this pinning pages costs more than copying them
+        static constexpr size_t zerocopy_threshold = 16 * 1024;
+        /**
+         * A client that sends nothing for this long is disconnected, which is what frees the slots of dead peers.
+         * Quiet clients are pinged with an empty frame along the way, a live client answers and stays. 0 disables.
+         */
+        std::chrono::seconds idle_timeout{45};
+        /// A client whose outbound queue hasn't moved for this long isn't reading and is disconnected. 0 disables.
+        std::chrono::seconds send_timeout{30};
+        /// Most bytes queued for one client before slow_client_policy applies, a single larger frame still fits
+        size_t max_outbound_bytes{8 * 1024 * 1024};
+        /// Most frames queued for one client before slow_client_policy applies
+        size_t max_outbound_frames{4096};
+        SlowClientPolicy slow_client_policy{SlowClientPolicy::COALESCE};
+        /// Broadcasts a client is sent when it registers so it sees what was being talked about, 0 disables.
+        /// Set before initialize_server
+        size_t history_size{64};
+        /// Longest username a client can register, it's what a relayed chat grows by
+        static constexpr size_t max_username_size = 64;
         /**
-         * Sends message to all connected clients
-         * @param message
+         * Largest message a client may send. Chats are relayed with the sender's name in front ("name: " in text,
+         * type byte, name length and name in binary) and clients drop frames over SocketMaxMessageSize()
          */
-        void broadcast(const std::string& message);
+        static constexpr size_t max_inbound_message_size = SocketMaxMessageSize() - 1 - Socket::max_header_size - max_username_size;
+        /**
+         * Sends message to all connected clients, including the ones connected to other shards
+         * @param message one of the Protocol messages
+         */
+        template<typename Message>
+        void broadcast(const Message& message) {
+            // encoded once per protocol, every recipient on every shard references these bytes until its send completes
+            broadcast(EncodedMessage{make_frame(Protocol::to_text(message)), make_frame(Protocol::encode_binary(message))});
+        }
+        /**
+         * Sends message to a single client
+         * @param client recipient
+         * @param message one of the Protocol messages
+         */
+        template<typename Message>
+        void unicast(Socket* client, const Message& message) {
+            auto found = connection(client->get_fd());
+            if (found == nullptr || found->state == ConnectionState::CLOSING) return;
+            enqueue(*found, frame_for(*found, message));
+        }
         /**
          * Constructs the Server object
          * @param _console to handle rendering to the screen
+         * @param _shards group the server belongs to
+         * @param _shard_id index of the server within the group
          */
-        explicit Server(SmartConsole::Console* _console);
+        Server(SmartConsole::Console* _console, ServerShards* _shards, size_t _shard_id);
         /// The function that gets run inside a loop that handles constant polling of the sockets
         void run_loop(struct timeval* timeout);
         void run_loop_timeout(size_t seconds, size_t microseconds = 0);
         void run_loop_timeout();
-        std::map<int, std::string> users;
+        /**
+         * Registered usernames of this shard's clients, safe to call from any shard
+         * @return one entry per REGISTERED connection
+         */
+        std::vector<std::string> usernames();
         std::thread initialize_server(const std::string& port, const std::string& ip);
     };
+
+    /**
+     * Runs several Server event loops side by side, one thread each.
+     * @details Every shard binds its own listening socket with SO_REUSEPORT so the kernel spreads
+     * incoming connections across them, and owns the clients it accepted. Broadcasts reach the
+     * other shards through their inboxes.
+     */
+    class ServerShards {
+    public:
+        /**
+         * Constructs the group
+         * @param console to handle rendering to the screen
+         * @param count how many event loops to run
+         * @param worker_count how many threads answer $getlog and $getlist
+         */
+        ServerShards(SmartConsole::Console* console, size_t count, size_t worker_count = 2);
+        std::vector<std::unique_ptr<Server>> servers;
+        /// Mapped and indexed log the workers answer $getlog from
+        Utilities::LogView log_view;
+        /// Answers commands that would stall an event loop ($getlog, $getlist) for every shard. Declared after
+        /// servers so it's joined first, a task finishing during shutdown still has a shard to post to
+        Utilities::WorkerPool workers;
+        /// Jobs started and not yet finished across every shard
+        std::atomic<size_t> jobs{0};
+        /// Most jobs at once, a command over the limit is answered with a "try again" notice
+        size_t max_jobs{16};
+        /// Connected clients across every shard, checked against the user limit
+        std::atomic<size_t> connected{0};
+        /// How often each SlowClientPolicy was applied, across every shard
+        struct SlowClientCounters {
+            /// Times DROP_OLDEST made room
+            std::atomic<size_t> dropped{0};
+            /// Times COALESCE made room
+            std::atomic<size_t> coalesced{0};
+            /// Clients disconnected, by DISCONNECT or because only frames that can't be dropped were left
+            std::atomic<size_t> disconnected{0};
+            /// Chat messages the two dropping policies threw away
+            std::atomic<size_t> frames_dropped{0};
+        } slow_clients;
+        /**
+         * Starts every shard on its own thread
+         * @return thread handles
+         */
+        std::vector<std::thread> initialize_servers(const std::string& port, const std::string& ip);
+    };
 } // ClientServerChatApp
 
 #endif //CLIENTSERVERCHATAPP_SERVER_H
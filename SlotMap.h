@@ -0,0 +1,111 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_SLOTMAP_H
+#define CLIENTSERVERCHATAPP_SLOTMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Utilities {
+    /**
+     * Handle to a value in a SlotMap. Slots are reused, the generation tells the value a key was made for
+     * apart from whatever occupies the slot now, so a stale key looks up nothing instead of the wrong value.
+     */
+    struct SlotKey {
+        uint32_t index{UINT32_MAX};
+        uint32_t generation{0};
+        bool operator==(const SlotKey&) const = default;
+    };
+
+    /**
+     * Container with O(1) insert, lookup and erase through keys that are never silently reused.
+     * @details Values are packed contiguously (iterating touches nothing but values) and a slot array maps keys to
+     * their current position. Erasing moves the last value into the hole, so pointers and references to values
+     * only stay valid until the next emplace or erase. Keys stay valid until their own value is erased.
+     * @tparam T stored value, has to be move assignable
+     */
+    template<typename T>
+    class SlotMap {
+    private:
+        struct Slot {
+            /// Position of the value in _values while occupied, next free slot while vacant
+            uint32_t position;
+            /// Bumped every time the slot is vacated, odd while occupied
+            uint32_t generation;
+        };
+        std::vector<Slot> _slots;
+        std::vector<T> _values;
+        /// Slot of each value, parallel to _values
+        std::vector<uint32_t> _owners;
+        /// Head of the list of vacant slots
+        uint32_t _free{UINT32_MAX};
+        static constexpr bool occupied(const Slot& slot) { return slot.generation & 1; }
+    public:
+        /**
+         * Constructs a value in a free slot
+         * @param args forwarded to T's constructor
+         * @return key of the new value
+         */
+        template<typename... Args>
+        SlotKey emplace(Args&&... args) {
+            uint32_t index;
+            if (_free != UINT32_MAX) {
+                index = _free;
+                _free = _slots[index].position;
+            } else {
+                index = (uint32_t)_slots.size();
+                _slots.push_back({0, 0});
+            }
+            auto& slot = _slots[index];
+            slot.position = (uint32_t)_values.size();
+            ++slot.generation;
+            _values.emplace_back(std::forward<Args>(args)...);
+            _owners.push_back(index);
+            return {index, slot.generation};
+        }
+        /**
+         * Looks up a value
+         * @param key from emplace
+         * @return the value, nullptr if it has been erased
+         */
+        T* get(SlotKey key) {
+            if (key.index >= _slots.size()) return nullptr;
+            const auto& slot = _slots[key.index];
+            if (slot.generation != key.generation || !occupied(slot)) return nullptr;
+            return &_values[slot.position];
+        }
+        /**
+         * Destroys a value, its key (and every copy of it) stops finding anything
+         * @param key from emplace
+         * @return false if the key was already stale
+         */
+        bool erase(SlotKey key) {
+            if (get(key) == nullptr) return false;
+            auto& slot = _slots[key.index];
+            auto position = slot.position;
+            if (position != _values.size() - 1) {
+                _values[position] = std::move(_values.back());
+                _owners[position] = _owners.back();
+                _slots[_owners[position]].position = position;
+            }
+            _values.pop_back();
+            _owners.pop_back();
+            ++slot.generation;
+            slot.position = _free;
+            _free = key.index;
+            return true;
+        }
+        size_t size() const { return _values.size(); }
+        bool empty() const { return _values.empty(); }
+        auto begin() { return _values.begin(); }
+        auto end() { return _values.end(); }
+        auto begin() const { return _values.begin(); }
+        auto end() const { return _values.end(); }
+    };
+} // Utilities
+
+#endif //CLIENTSERVERCHATAPP_SLOTMAP_H
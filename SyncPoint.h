@@ -9,44 +9,115 @@
  * Super totally awesome synchronization primitive
  * Meant for data to be consumed very quickly, or to trigger async events on other threads
  * Works like a reusable promise
- * @tparam T
+ * @details The data is kept in place, nothing is allocated. Resolving again before it's retrieved replaces the
+ * data, so a burst of resolves costs the receiver one wakeup and it sees the latest. The receiver waits on an
+ * atomic (a futex on Linux) that resolve only notifies when it's the first since the last retrieve.
+ * @tparam T has to be move constructible
  */
 template<typename T>
 class SyncPoint {
 private:
     /// Data can be anything
-    T* data;
+    std::optional<T> data;
     /// Protects access to data
     std::mutex mtx;
-    /// Allows receiver to wait until data has been resolved
-    std::condition_variable cv;
+    /// Whether data is there, the receiver waits on it. Futex sized so waiting on it doesn't go through a table
+    std::atomic<uint32_t> ready{0};
 public:
-    SyncPoint(): data(nullptr) {}
-    ~SyncPoint() {
-        delete data;
-    }
+    SyncPoint() = default;
+    SyncPoint(const SyncPoint&) = delete;
+    SyncPoint& operator=(const SyncPoint&) = delete;
     /**
      * Sends data to receiver
      * @param to the data
      */
     void resolve(T to) {
-        UniqueLock lock{mtx};
-        data = new T{to};
-        cv.notify_all();
+        bool was_ready;
+        {
+            UniqueLock lock{mtx};
+            data = std::move(to);
+            was_ready = ready.exchange(1, std::memory_order_release);
+        }
+        // a receiver can only be waiting if nothing was there
+        if (!was_ready) ready.notify_one();
     }
     /**
-     * Receives the data sent by resolve and deletes the data from the heap
+     * Receives the data sent by resolve, waits until there is some
      * @return
      */
     T retrieve() {
+        while (true) {
+            if (ready.load(std::memory_order_acquire) == 0) {
+                ready.wait(0, std::memory_order_acquire);
+                continue;
+            }
+            UniqueLock lock{mtx};
+            // another receiver may have taken it first
+            if (!data) continue;
+            T rv = std::move(*data);
+            data.reset();
+            ready.store(0, std::memory_order_relaxed);
+            return rv;
+        }
+    }
+    /**
+     * Takes the data sent by resolve if there is any, without waiting
+     * @return
+     */
+    std::optional<T> try_retrieve() {
+        if (ready.load(std::memory_order_acquire) == 0) return std::nullopt;
         UniqueLock lock{mtx};
-        cv.wait(lock, [&]{ return data != nullptr; });
-        T rv = *data;
-        delete data;
-        data = nullptr;
+        std::optional<T> rv = std::move(data);
+        data.reset();
+        ready.store(0, std::memory_order_relaxed);
         return rv;
     }
 };
 
+/**
+ * SyncPoint for plain signals, the whole thing is one atomic
+ */
+template<>
+class SyncPoint<bool> {
+private:
+    enum State: uint32_t {
+        EMPTY,
+        RESOLVED_FALSE,
+        RESOLVED_TRUE
+    };
+    /// Futex sized so waiting on it doesn't go through a table
+    std::atomic<uint32_t> state{EMPTY};
+public:
+    SyncPoint() = default;
+    SyncPoint(const SyncPoint&) = delete;
+    SyncPoint& operator=(const SyncPoint&) = delete;
+    /**
+     * Sends data to receiver
+     * @param to the data
+     */
+    void resolve(bool to) {
+        // a receiver can only be waiting if nothing was there
+        if (state.exchange(to ? RESOLVED_TRUE : RESOLVED_FALSE, std::memory_order_release) == EMPTY) state.notify_one();
+    }
+    /**
+     * Receives the data sent by resolve, waits until there is some
+     * @return
+     */
+    bool retrieve() {
+        uint32_t taken;
+        while ((taken = state.exchange(EMPTY, std::memory_order_acquire)) == EMPTY) state.wait(EMPTY, std::memory_order_relaxed);
+        return taken == RESOLVED_TRUE;
+    }
+    /**
+     * Takes the data sent by resolve if there is any, without waiting
+     * @return
+     */
+    std::optional<bool> try_retrieve() {
+        auto taken = state.exchange(EMPTY, std::memory_order_acquire);
+        if (taken == EMPTY) return std::nullopt;
+        return taken == RESOLVED_TRUE;
+    }
+};
+
 
 #endif //CLIENTSERVERCHATAPP_SYNCPOINT_H
@@ -0,0 +1,229 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_TIMERWHEEL_H
+#define CLIENTSERVERCHATAPP_TIMERWHEEL_H
+
+#include "SlotMap.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Utilities {
+    /**
+     * Hierarchical timer wheel, the timers of an event loop.
+     * @details Time is counted in ticks of a fixed resolution. Level 0 has one slot per tick for the next 64 ticks,
+     * every level above has slots 64 times as wide. A timer goes into the finest level that can tell its tick
+     * apart and moves down (cascades) as its time comes closer, so arm and cancel are O(1) list operations no matter
+     * how many timers there are. Expiring is O(1) per timer, and empty stretches are skipped using each level's
+     * occupancy bitmap instead of being walked tick by tick.
+     *
+     * Timers carry a 64 bit payload instead of a callback, the caller decides what it means (a connection's
+     * key and what the timer is for, say) and nothing is allocated per timer once the node pool has grown.
+     */
+    class TimerWheel {
+    public:
+        using Clock = std::chrono::steady_clock;
+        /// Bits of the tick each level covers
+        static constexpr unsigned slot_bits = 6;
+        static constexpr size_t slots_per_level = size_t{1} << slot_bits;
+        static constexpr size_t levels = 4;
+        /// Longest delay in ticks, longer ones are clamped (64^4 ticks is ~46 hours at 10ms)
+        static constexpr uint64_t max_ticks = (slots_per_level - 1) << (slot_bits * (levels - 1));
+    private:
+        static constexpr uint32_t none = UINT32_MAX;
+        struct Node {
+            /// Tick the timer is due
+            uint64_t expires;
+            uint64_t payload;
+            /// Neighbours in the slot list while armed, next free node while not
+            uint32_t prev;
+            uint32_t next;
+            /// Odd while armed, like SlotMap's slots
+            uint32_t generation;
+            /// Slot the node is linked into, level * slots_per_level + index
+            uint32_t bucket;
+        };
+        std::vector<Node> _nodes;
+        uint32_t _free{none};
+        std::array<uint32_t, levels * slots_per_level> _heads;
+        /// One bit per non-empty slot of each level
+        std::array<uint64_t, levels> _occupied{};
+        Clock::time_point _origin;
+        Clock::duration _resolution;
+        /// Every tick up to and including this one has been expired
+        uint64_t _tick{0};
+        size_t _size{0};
+
+        static constexpr uint64_t level_mask(size_t level) { return (uint64_t{1} << (slot_bits * level)) - 1; }
+
+        void link(uint32_t index) {
+            auto& node = _nodes[index];
+            // the finest level whose slots tell expires apart from now, never the current slot of a level above 0
+            size_t level = 0;
+            while (level + 1 < levels && (node.expires >> (slot_bits * level)) - (_tick >> (slot_bits * level)) >= slots_per_level) ++level;
+            auto slot = (node.expires >> (slot_bits * level)) & (slots_per_level - 1);
+            node.bucket = (uint32_t)(level * slots_per_level + slot);
+            node.prev = none;
+            node.next = _heads[node.bucket];
+            if (node.next != none) _nodes[node.next].prev = index;
+            _heads[node.bucket] = index;
+            _occupied[level] |= uint64_t{1} << slot;
+        }
+
+        void unlink(uint32_t index) {
+            auto& node = _nodes[index];
+            if (node.prev != none) _nodes[node.prev].next = node.next;
+            else _heads[node.bucket] = node.next;
+            if (node.next != none) _nodes[node.next].prev = node.prev;
+            if (_heads[node.bucket] == none) {
+                _occupied[node.bucket / slots_per_level] &= ~(uint64_t{1} << (node.bucket % slots_per_level));
+            }
+        }
+
+        void release(uint32_t index) {
+            unlink(index);
+            auto& node = _nodes[index];
+            ++node.generation;
+            node.next = _free;
+            _free = index;
+            --_size;
+        }
+
+        /// Moves every timer of a slot one or more levels down
+        void cascade(size_t level, size_t slot) {
+            auto index = _heads[level * slots_per_level + slot];
+            _heads[level * slots_per_level + slot] = none;
+            _occupied[level] &= ~(uint64_t{1} << slot);
+            while (index != none) {
+                auto next = _nodes[index].next;
+                link(index);
+                index = next;
+            }
+        }
+
+        /**
+         * Earliest tick something happens: a level 0 slot expires or a higher slot cascades
+         * @return 0 if there are no timers
+         */
+        uint64_t next_event() const {
+            uint64_t next = 0;
+            for (size_t level = 0; level < levels; ++level) {
+                if (_occupied[level] == 0) continue;
+                auto position = (_tick >> (slot_bits * level)) & (slots_per_level - 1);
+                // distance to the first occupied slot after the current one
+                auto distance = std::countr_zero(std::rotr(_occupied[level], (int)((position + 1) % slots_per_level))) + 1;
+                auto tick = ((_tick >> (slot_bits * level)) + distance) << (slot_bits * level);
+                if (next == 0 || tick < next) next = tick;
+            }
+            return next;
+        }
+
+        uint64_t ticks_at(Clock::time_point time) const {
+            if (time <= _origin) return 0;
+            return (uint64_t)((time - _origin) / _resolution);
+        }
+    public:
+        /**
+         * Constructs an empty wheel
+         * @param resolution length of a tick, timers fire within a tick of their deadline
+         * @param origin time of tick 0
+         */
+        explicit TimerWheel(Clock::duration resolution, Clock::time_point origin = Clock::now()):
+            _origin(origin), _resolution(resolution) {
+            _heads.fill(none);
+        }
+
+        /**
+         * Starts a timer
+         * @param delay from the time given to the last advance (or the origin), rounded up to a whole tick
+         * @param payload handed back when the timer fires
+         * @return key to cancel the timer with
+         */
+        SlotKey arm(Clock::duration delay, uint64_t payload) {
+            auto ticks = (uint64_t)std::max<Clock::rep>(1, (delay + _resolution - Clock::duration{1}) / _resolution);
+            uint32_t index;
+            if (_free != none) {
+                index = _free;
+                _free = _nodes[index].next;
+            } else {
+                index = (uint32_t)_nodes.size();
+                _nodes.push_back({0, 0, none, none, 0, 0});
+            }
+            auto& node = _nodes[index];
+            node.expires = _tick + std::min(ticks, max_ticks);
+            node.payload = payload;
+            ++node.generation;
+            link(index);
+            ++_size;
+            return {index, node.generation};
+        }
+
+        /**
+         * Stops a timer before it fires
+         * @param key from arm
+         * @return false if the timer already fired or was cancelled
+         */
+        bool cancel(SlotKey key) {
+            if (key.index >= _nodes.size()) return false;
+            const auto& node = _nodes[key.index];
+            if (node.generation != key.generation || (node.generation & 1) == 0) return false;
+            release(key.index);
+            return true;
+        }
+
+        /**
+         * Fires every timer due by now, in tick order. A timer is disarmed before it fires, so fire may arm it
+         * again or arm and cancel others.
+         * @param now current time
+         * @param fire called with the payload of each timer
+         */
+        template<typename Fire>
+        void advance(Clock::time_point now, Fire&& fire) {
+            auto target = ticks_at(now);
+            while (_tick < target) {
+                auto next = next_event();
+                if (next == 0 || next > target) {
+                    _tick = target;
+                    return;
+                }
+                // nothing happens in between, jump straight to the next event
+                _tick = next;
+                for (size_t level = levels - 1; level > 0; --level) {
+                    if ((_tick & level_mask(level)) == 0) cascade(level, (_tick >> (slot_bits * level)) & (slots_per_level - 1));
+                }
+                auto slot = _tick & (slots_per_level - 1);
+                while (_heads[slot] != none) {
+                    auto index = _heads[slot];
+                    auto payload = _nodes[index].payload;
+                    release(index);
+                    fire(payload);
+                }
+            }
+        }
+
+        /**
+         * How long an event loop can wait before the next advance has something to do
+         * @param now current time
+         * @return milliseconds, rounded up, or -1 if no timer is armed (epoll/kqueue conventions)
+         */
+        int next_timeout_ms(Clock::time_point now) const {
+            if (_size == 0) return -1;
+            auto due = _origin + _resolution * (Clock::rep)next_event();
+            if (due <= now) return 0;
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(due - now).count();
+            return (int)std::min<decltype(wait)>(wait, INT32_MAX);
+        }
+
+        /// Armed timers
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+    };
+} // Utilities
+
+#endif //CLIENTSERVERCHATAPP_TIMERWHEEL_H
@@ -0,0 +1,43 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#include "WorkerPool.h"
+
+namespace Utilities {
+    WorkerPool::WorkerPool(size_t threads) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) _threads.emplace_back([this] { work(); });
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            UniqueLock lock{_mtx};
+            _stopping = true;
+            _tasks.clear();
+        }
+        _cv.notify_all();
+        for (auto& thread : _threads) thread.join();
+    }
+
+    void WorkerPool::submit(std::function<void()> task) {
+        {
+            UniqueLock lock{_mtx};
+            _tasks.push_back(std::move(task));
+        }
+        _cv.notify_one();
+    }
+
+    void WorkerPool::work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                UniqueLock lock{_mtx};
+                _cv.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+                if (_stopping) return;
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+} // Utilities
@@ -0,0 +1,42 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_WORKERPOOL_H
+#define CLIENTSERVERCHATAPP_WORKERPOOL_H
+
+namespace Utilities {
+    /**
+     * Fixed number of threads running tasks in the order they were submitted.
+     * @details For work that would stall an event loop (file reads, walking every shard). The queue isn't bounded
+     * here, callers limit how much they submit and get results back through their own channel.
+     */
+    class WorkerPool {
+    private:
+        std::vector<std::thread> _threads;
+        std::deque<std::function<void()>> _tasks;
+        std::mutex _mtx;
+        std::condition_variable _cv;
+        bool _stopping{false};
+        void work();
+    public:
+        /**
+         * Starts the threads
+         * @param threads how many tasks run at once, at least 1
+         */
+        explicit WorkerPool(size_t threads);
+        /// Lets running tasks finish, drops the ones that haven't started and joins the threads
+        ~WorkerPool();
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+        /**
+         * Queues a task, it runs on whichever thread is free first
+         * @param task must not throw
+         */
+        void submit(std::function<void()> task);
+        /// Number of threads
+        size_t size() const { return _threads.size(); }
+    };
+} // Utilities
+
+#endif //CLIENTSERVERCHATAPP_WORKERPOOL_H
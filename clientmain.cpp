@@ -1,7 +1,8 @@
 #include "Console.h"
-#include "Commands.h"
+#include "Protocol.h"
 #include "Client.h"
 #include "ShutdownTasks.h"
+#include <getopt.h>
 
 #define PHASE 2
 
@@ -9,7 +10,29 @@ void disable_echo(struct termios* orig);
 
 //void prompt_for_connection_details(std::vector<std::string>* messages);
 
-int main() {
+int main(int argc, char** argv) {
+    std::optional<size_t> fps;
+    bool stats = false;
+    const struct option long_options[] = {
+        {"fps", required_argument, nullptr, 'f'},
+        {"stats", no_argument, nullptr, 's'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:s", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'f': {
+                if (!std::regex_match(optarg, std::regex{"[1-9][0-9]{0,2}"})) {
+                    std::cout << "--fps expects a number of frames per second between 1 and 999" << std::endl;
+                    return 1;
+                }
+                fps = std::stoul(optarg);
+                break;
+            }
+            case 's': stats = true; break;
+            default: return 1;
+        }
+    }
     // Get original terminal input/output structure
     struct termios orig_tios;
     tcgetattr(STDIN_FILENO, &orig_tios);
@@ -19,7 +42,9 @@ int main() {
         tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_tios);
     });
 
-    SmartConsole::Console console{"$register, $exit, $getlist, $getlog"};
+    SmartConsole::Console console{"$register, $exit, $getlist, $getlog [from] [count]"};
+    if (fps) console.frame_interval = std::chrono::microseconds{1'000'000 / *fps};
+    console.show_stats = stats;
     SmartConsole::Clear(std::cout);
     // Create initial messages
 #if PHASE == 1
@@ -97,11 +122,11 @@ int main() {
                 UniqueLock lock{console.messages_mtx};
                 console.messages.emplace_back("[INFO]: " + ip_address);
                 console.messages.emplace_back("Excellent! Now enter the port number.");
-                console.refresh_text.resolve(true);
+                console.refresh();
             } else {
                 UniqueLock lock{console.messages_mtx};
                 console.messages.emplace_back("[ERROR]: You entered an invalid IP address. Please try again.");
-                console.refresh_text.resolve(true);
+                console.refresh();
             }
             continue;
         }
@@ -112,24 +137,24 @@ int main() {
                 UniqueLock lock{console.messages_mtx};
                 console.messages.emplace_back("[INFO]: " + port);
                 console.messages.emplace_back("Alright, now all you have to do is use the $register command to join the server.");
-                console.refresh_text.resolve(true);
+                console.refresh();
             } else {
                 UniqueLock lock{console.messages_mtx};
                 console.messages.emplace_back("[ERROR]: You entered an invalid Port number. Please try again.");
-                console.refresh_text.resolve(true);
+                console.refresh();
             }
             continue;
         }
 #endif
         // Begin registration
         if (!registered) {
-            if (!user_msg.starts_with(ClientServerChatApp::Commands::REGISTER())) {
+            if (!user_msg.starts_with(ClientServerChatApp::Protocol::Text::REGISTER)) {
                 UniqueLock lock{console.messages_mtx};
                 console.messages.emplace_back("[ERROR]: You have to register before entering commands or messages to the chat room");
-                console.refresh_text.resolve(true);
+                console.refresh();
                 continue;
             }
-            username = user_msg.substr(10);
+            username = user_msg.substr(ClientServerChatApp::Protocol::Text::REGISTER.size());
             client.sync_username.resolve(username);
             auto res = client.sync_socket_created.retrieve();
             if (!res) continue;
@@ -140,7 +165,7 @@ int main() {
         }
 
         // at this point client is registered so begin echoing user input to server
-        client.send_buffer.tx(user_msg);
+        client.send_buffer.tx(std::move(user_msg));
     }
 
     return 0;
@@ -266,6 +266,18 @@ namespace LibSocket {
         SocketConnectError::INVALID_ADDRESS,
         SocketConnectError::INVALID_PORT,
     };
+    enum class SocketFcntlError {
+        /// The argument sockfd is not a valid file descriptor.
+        BAD_FD = EBADF,
+        /// The requested flags are not valid for this file descriptor
+        INVALID = EINVAL,
+        /// Indicates successful creation and used by creation handler
+        SUCCESS
+    };
+    constexpr std::initializer_list<SocketFcntlError> all_fcntl_errors = {
+        SocketFcntlError::BAD_FD,
+        SocketFcntlError::INVALID,
+    };
     enum class SocketGetPeerNameError {
         /// The argument sockfd is not a valid file descriptor.
         BAD_FD = EBADF,
@@ -379,10 +391,19 @@ namespace LibSocket {
         NO_MEMORY = ENOMEM,
         /// The socket associated with a connection-oriented protocol has not been connected
         NOT_CONNECTED = ENOTCONN,
+        /// The peer reset the connection (e.g. it closed with unread data)
+        CONNECTION_RESET = ECONNRESET,
+        /// The connection timed out, e.g. keepalive probes went unanswered
+        TIMED_OUT = ETIMEDOUT,
         /// The file descriptor sockfd does not refer to a socket
         NOT_A_SOCKET = ENOTSOCK,
+        // the rest aren't errnos, they're numbered past every errno so a recv failure can't be mistaken for one
         /// Socket is disconnecting
-        DISCONNECTING,
+        DISCONNECTING = 200,
+        /// The peer announced a message larger than Socket::max_message_size or sent a malformed header
+        MESSAGE_TOO_LARGE = 201,
+        /// The peer sent an empty frame, a keepalive that carries no message
+        HEARTBEAT = 202,
         /// Indicates successful creation and used by creation handler
         SUCCESS
     };
@@ -396,6 +417,8 @@ namespace LibSocket {
         SocketReceiveError::INVALID_ARG,
         SocketReceiveError::NO_MEMORY,
         SocketReceiveError::NOT_CONNECTED,
+        SocketReceiveError::CONNECTION_RESET,
+        SocketReceiveError::TIMED_OUT,
         SocketReceiveError::NOT_A_SOCKET,
     };
     enum class SocketSelectError {
@@ -417,6 +440,84 @@ namespace LibSocket {
         SocketSelectError::INVALID,
         SocketSelectError::NO_MEMORY,
     };
+    enum class ReactorError {
+        /// The reactor or the registered file descriptor is not a valid file descriptor
+        BAD_FD = EBADF,
+        /// The file descriptor is already registered with this reactor
+        ALREADY_REGISTERED = EEXIST,
+        /// The file descriptor is not registered with this reactor
+        NOT_REGISTERED = ENOENT,
+        /// The event buffer is not accessible with write permissions
+        FAULT = EFAULT,
+        /// A signal was caught before any events became ready or the timeout expired
+        INTERRUPTED = EINTR,
+        /// Invalid flags, the reactor was not created, or the fd is the reactor itself
+        INVALID = EINVAL,
+        /// Registering the file descriptor would create a circular loop of reactors
+        LOOP = ELOOP,
+        /// Insufficient memory available
+        NO_MEMORY = ENOMEM,
+        /// The per-user limit on registered file descriptors has been reached
+        LIMIT_REACHED = ENOSPC,
+        /// The file descriptor does not support readiness notifications (e.g. regular files)
+        NOT_SUPPORTED = EPERM,
+        /// Per-process or system-wide limit on the total number of open files has been reached
+        OPEN_FD_LIMIT = EMFILE,
+        /// Indicates success, numbered past every errno (OPEN_FD_LIMIT + 1 is ENOTTY) so no failure maps onto it
+        SUCCESS = 200
+    };
+    constexpr std::initializer_list<ReactorError> all_reactor_errors = {
+        ReactorError::BAD_FD,
+        ReactorError::ALREADY_REGISTERED,
+        ReactorError::NOT_REGISTERED,
+        ReactorError::FAULT,
+        ReactorError::INTERRUPTED,
+        ReactorError::INVALID,
+        ReactorError::LOOP,
+        ReactorError::NO_MEMORY,
+        ReactorError::LIMIT_REACHED,
+        ReactorError::NOT_SUPPORTED,
+        ReactorError::OPEN_FD_LIMIT,
+    };
+    enum class IoUringError {
+        /// The kernel could not allocate resources for the requests, try again later
+        AGAIN = EAGAIN,
+        /// The ring is not a valid file descriptor
+        BAD_FD = EBADF,
+        /// The completion queue is full, completions have to be harvested before submitting more
+        BUSY = EBUSY,
+        /// The ring parameters or buffers are outside the accessible address space
+        FAULT = EFAULT,
+        /// A signal was caught while waiting for completions
+        INTERRUPTED = EINTR,
+        /// Invalid entry count, flags, or submission entry
+        INVALID = EINVAL,
+        /// Per-process limit on the number of open files has been reached
+        OPEN_FD_LIMIT = EMFILE,
+        /// System-wide limit on the total number of open files has been reached
+        SYSTEM_FD_LIMIT = ENFILE,
+        /// Insufficient memory available to map the rings
+        NO_MEMORY = ENOMEM,
+        /// io_uring has been disabled by sysctl or a seccomp policy
+        NOT_PERMITTED = EPERM,
+        /// The kernel (or this build of libsocket) has no io_uring support
+        NOT_SUPPORTED = ENOSYS,
+        /// Indicates success, numbered past every errno (NOT_SUPPORTED + 1 is ENOTEMPTY) so no failure maps onto it
+        SUCCESS = 200
+    };
+    constexpr std::initializer_list<IoUringError> all_io_uring_errors = {
+        IoUringError::AGAIN,
+        IoUringError::BAD_FD,
+        IoUringError::BUSY,
+        IoUringError::FAULT,
+        IoUringError::INTERRUPTED,
+        IoUringError::INVALID,
+        IoUringError::OPEN_FD_LIMIT,
+        IoUringError::SYSTEM_FD_LIMIT,
+        IoUringError::NO_MEMORY,
+        IoUringError::NOT_PERMITTED,
+        IoUringError::NOT_SUPPORTED,
+    };
     enum class SocketSendError {
         /// The socket is nonblocking and no connections are present to be accepted
         AGAIN = EAGAIN,
@@ -0,0 +1,137 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_HANDLERTABLE_H
+#define CLIENTSERVERCHATAPP_HANDLERTABLE_H
+
+#include "Errors.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+
+namespace LibSocket {
+    /// Every error enum value (errno or not) has to be below this to get a slot
+    constexpr size_t handler_table_size = 256;
+
+    /**
+     * Checks at compile time that every error in a list fits in a HandlerTable
+     * @param errors one of the all_*_errors lists
+     * @return true if every value is below handler_table_size
+     */
+    template<typename ErrorType>
+    constexpr bool fits_handler_table(std::initializer_list<ErrorType> errors) {
+        for (auto err : errors) if ((size_t)err >= handler_table_size) return false;
+        return (size_t)ErrorType::SUCCESS < handler_table_size;
+    }
+
+    template<typename ErrorType, typename Signature>
+    class HandlerTable;
+
+    /**
+     * The callbacks to run for each outcome of a syscall, indexed directly by errno.
+     * @details Reads like the std::map it replaces (operator[], contains, erase) but a lookup is one array index
+     * instead of a tree walk, and SUCCESS has its own slot so the common path doesn't index anything. Handlers stay
+     * std::function since they're closures chosen at runtime (the client swaps its receive handler mid-conversation).
+     *
+     * Copies share their handlers: copying a table is one reference count, and the first change made through a
+     * copy gives that copy its own handlers (copy-on-write). A server builds the table its clients need once and
+     * every accepted socket points at it. An empty table allocates nothing.
+     */
+    template<typename ErrorType, typename Result, typename... Args>
+    class HandlerTable<ErrorType, Result(Args...)> {
+    public:
+        using Handler = std::function<Result(Args...)>;
+    private:
+        struct Storage {
+            /// Position + 1 of each error's handler in handlers, 0 if it never had one
+            std::array<uint8_t, handler_table_size> slots{};
+            /// A deque so a handler that registers another one doesn't move itself while running
+            std::deque<Handler> handlers;
+            Handler success;
+        };
+        std::shared_ptr<Storage> _storage;
+        /// Storage only this table uses, made on the first change
+        Storage& writable() {
+            if (_storage == nullptr) _storage = std::make_shared<Storage>();
+            else if (_storage.use_count() > 1) _storage = std::make_shared<Storage>(*_storage);
+            return *_storage;
+        }
+        /// Handler for an error, nullptr if there is none
+        const Handler* find(size_t err) const {
+            if (_storage == nullptr || err >= handler_table_size) return nullptr;
+            auto slot = _storage->slots[err];
+            if (slot == 0 || !_storage->handlers[slot - 1]) return nullptr;
+            return &_storage->handlers[slot - 1];
+        }
+    public:
+        /**
+         * Gets the handler for an outcome, creating an empty one if there is none yet
+         * @param key outcome
+         * @return handler that can be assigned to
+         */
+        Handler& operator[](ErrorType key) {
+            auto& storage = writable();
+            if (key == ErrorType::SUCCESS) return storage.success;
+            auto& slot = storage.slots[(size_t)key];
+            if (slot == 0) {
+                storage.handlers.emplace_back();
+                slot = (uint8_t)storage.handlers.size();
+            }
+            return storage.handlers[slot - 1];
+        }
+        /// Whether a handler is set for an outcome
+        bool contains(ErrorType key) const {
+            if (key == ErrorType::SUCCESS) return _storage != nullptr && (bool)_storage->success;
+            return find((size_t)key) != nullptr;
+        }
+        /// Removes the handler for an outcome
+        void erase(ErrorType key) {
+            if (!contains(key)) return;
+            auto& storage = writable();
+            if (key == ErrorType::SUCCESS) storage.success = nullptr;
+            else storage.handlers[storage.slots[(size_t)key] - 1] = nullptr;
+        }
+        /// Runs the handler for an outcome if there is one, errno values that were cast to ErrorType are fine
+        void run(ErrorType key, Args... args) const {
+            if (key == ErrorType::SUCCESS) {
+                if (_storage != nullptr && _storage->success) _storage->success(args...);
+                return;
+            }
+            if (auto handler = find((size_t)key)) (*handler)(args...);
+        }
+        /**
+         * Runs the SUCCESS handler or the handler for errno, whichever applies
+         * @param failed whether the syscall failed
+         * @param err errno after the syscall, only looked at if failed
+         */
+        void dispatch(bool failed, int err, Args... args) const {
+            if (!failed) {
+                if (_storage != nullptr && _storage->success) _storage->success(args...);
+                return;
+            }
+            if (err < 0) return;
+            if (auto handler = find((size_t)err)) (*handler)(args...);
+        }
+    };
+
+    static_assert(fits_handler_table(all_create_errors));
+    static_assert(fits_handler_table(all_accept_errors));
+    static_assert(fits_handler_table(all_bind_errors));
+    static_assert(fits_handler_table(all_close_errors));
+    static_assert(fits_handler_table(all_connect_errors));
+    static_assert(fits_handler_table(all_fcntl_errors));
+    static_assert(fits_handler_table(all_listen_errors));
+    static_assert(fits_handler_table(all_receive_errors));
+    static_assert(fits_handler_table(all_select_errors));
+    static_assert(fits_handler_table(all_reactor_errors));
+    static_assert(fits_handler_table(all_io_uring_errors));
+    static_assert(fits_handler_table(all_send_errors));
+    static_assert((size_t)SocketReceiveError::MESSAGE_TOO_LARGE < handler_table_size);
+} // LibSocket
+
+#endif //CLIENTSERVERCHATAPP_HANDLERTABLE_H
@@ -0,0 +1,187 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#include "IoUring.h"
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#if defined(LIBSOCKET_IO_URING)
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#endif
+
+namespace LibSocket {
+    IoUring::IoUring(unsigned entries): _entries{entries}, _completed() {
+        _completed.reserve(entries * 2);
+    }
+
+#if defined(LIBSOCKET_IO_URING)
+    static_assert(sizeof(__kernel_timespec) == 16, "timeout storage must match __kernel_timespec");
+
+    IoUring::~IoUring() {
+        if (_sqes != nullptr) ::munmap(_sqes, _sqes_size);
+        if (_cq_ptr != nullptr && _cq_ptr != _sq_ptr) ::munmap(_cq_ptr, _cq_size);
+        if (_sq_ptr != nullptr) ::munmap(_sq_ptr, _sq_size);
+        if (_fd != -1) ::close(_fd);
+    }
+
+    void IoUring::create() {
+        struct io_uring_params params{};
+        _fd = (int)::syscall(__NR_io_uring_setup, _entries, &params);
+        auto err = errno;
+        if (_fd == -1) {
+            create_handlers.dispatch(true, err);
+            return;
+        }
+        _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        // newer kernels map both rings with one mmap
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+        _sq_ptr = ::mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+        if (_sq_ptr == MAP_FAILED) _sq_ptr = nullptr;
+        if (_sq_ptr != nullptr && single_mmap) {
+            _cq_ptr = _sq_ptr;
+        } else if (_sq_ptr != nullptr) {
+            _cq_ptr = ::mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+            if (_cq_ptr == MAP_FAILED) _cq_ptr = nullptr;
+        }
+        _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        if (_cq_ptr != nullptr) {
+            void* sqes = ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+            _sqes = sqes == MAP_FAILED ? nullptr : (struct io_uring_sqe*)sqes;
+        }
+        if (_sqes == nullptr) {
+            err = errno;
+            ::close(_fd);
+            _fd = -1;
+            create_handlers.dispatch(true, err);
+            return;
+        }
+        auto sq = (char*)_sq_ptr;
+        _sq_head = (unsigned*)(sq + params.sq_off.head);
+        _sq_tail = (unsigned*)(sq + params.sq_off.tail);
+        _sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+        _sq_entries = *(unsigned*)(sq + params.sq_off.ring_entries);
+        _sq_array = (unsigned*)(sq + params.sq_off.array);
+        _local_tail = *_sq_tail;
+        auto cq = (char*)_cq_ptr;
+        _cq_head = (unsigned*)(cq + params.cq_off.head);
+        _cq_tail = (unsigned*)(cq + params.cq_off.tail);
+        _cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+        _cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+        create_handlers.run(IoUringError::SUCCESS);
+    }
+
+    int IoUring::enter(unsigned to_submit, unsigned min_complete, bool wait) {
+        return (int)::syscall(__NR_io_uring_enter, _fd, to_submit, min_complete, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    }
+
+    io_uring_sqe* IoUring::next_sqe() {
+        unsigned head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+        if (_local_tail - head >= _sq_entries) {
+            // queue is full, hand what we have to the kernel without waiting
+            __atomic_store_n(_sq_tail, _local_tail, __ATOMIC_RELEASE);
+            auto submitted = enter(_pending, 0, false);
+            if (submitted > 0) _pending -= std::min((unsigned)submitted, _pending);
+        }
+        unsigned index = _local_tail & _sq_mask;
+        auto sqe = &_sqes[index];
+        std::memset(sqe, 0, sizeof *sqe);
+        _sq_array[index] = index;
+        ++_local_tail;
+        ++_pending;
+        return sqe;
+    }
+
+    void IoUring::prepare_accept(int fd, uint64_t user_data) {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        // the ring does the waiting, the clients can stay blocking
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = user_data;
+    }
+
+    void IoUring::prepare_recv(int fd, void* buffer, size_t length, uint64_t user_data) {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)buffer;
+        sqe->len = (uint32_t)length;
+        sqe->user_data = user_data;
+    }
+
+    void IoUring::prepare_send(int fd, const void* buffer, size_t length, uint64_t user_data) {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)buffer;
+        sqe->len = (uint32_t)length;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = user_data;
+    }
+
+    void IoUring::prepare_poll(int fd, uint64_t user_data) {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = user_data;
+    }
+
+    void IoUring::harvest() {
+        unsigned head = *_cq_head;
+        unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const auto& cqe = _cqes[head & _cq_mask];
+            if (cqe.user_data == timeout_user_data) continue;
+            _completed.push_back({cqe.user_data, cqe.res});
+        }
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    const std::vector<IoUringCompletion>& IoUring::submit_and_wait(int timeout_ms) {
+        _completed.clear();
+        // don't sleep if the kernel already finished something
+        bool ready = *_cq_head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        if (!ready && timeout_ms >= 0) {
+            // wakes the wait up when either one more request completes or the time runs out
+            _timeout.tv_sec = timeout_ms / 1000;
+            _timeout.tv_nsec = (int64_t)(timeout_ms % 1000) * 1000000;
+            auto sqe = next_sqe();
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = (uint64_t)&_timeout;
+            sqe->len = 1;
+            sqe->off = 1;
+            sqe->user_data = timeout_user_data;
+        }
+        if (ready && _pending == 0) {
+            harvest();
+            return _completed;
+        }
+        __atomic_store_n(_sq_tail, _local_tail, __ATOMIC_RELEASE);
+        auto result = enter(_pending, ready ? 0 : 1, !ready);
+        auto err = errno;
+        if (result >= 0) _pending -= std::min((unsigned)result, _pending);
+        submit_handlers.dispatch(result == -1, err);
+        harvest();
+        return _completed;
+    }
+#else
+    IoUring::~IoUring() = default;
+
+    void IoUring::create() {
+        create_handlers.run(IoUringError::NOT_SUPPORTED);
+    }
+    void IoUring::prepare_accept(int, uint64_t) {}
+    void IoUring::prepare_recv(int, void*, size_t, uint64_t) {}
+    void IoUring::prepare_send(int, const void*, size_t, uint64_t) {}
+    void IoUring::prepare_poll(int, uint64_t) {}
+    const std::vector<IoUringCompletion>& IoUring::submit_and_wait(int) { return _completed; }
+#endif
+} // LibSocket
@@ -0,0 +1,132 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_IOURING_H
+#define CLIENTSERVERCHATAPP_IOURING_H
+
+#include "Errors.h"
+#include "HandlerTable.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace LibSocket {
+    /**
+     * Result of one finished request
+     */
+    struct IoUringCompletion {
+        /// The value the request was prepared with
+        uint64_t user_data;
+        /// Same as the return value of the equivalent syscall, except errors are returned as -errno
+        int result;
+    };
+
+    /**
+     * Minimal io_uring wrapper that talks to the kernel directly (no liburing dependency).
+     * @details Requests are only prepared by the prepare_* methods. Nothing reaches the kernel until
+     * submit_and_wait, which pushes every prepared request and harvests every finished one with a single
+     * io_uring_enter. That is what turns one syscall per send/receive into one syscall per loop iteration.
+     * Only functional on Linux 5.6+ in builds configured with LIBSOCKET_IO_URING, everywhere else create()
+     * runs the NOT_SUPPORTED handler so callers can fall back to the Reactor.
+     */
+    class IoUring {
+    private:
+        /// File descriptor of the ring
+        int _fd{-1};
+        /// Requested number of submission entries
+        unsigned _entries;
+        // Shared memory with the kernel, see io_uring_setup(2)
+        void* _sq_ptr{nullptr};
+        size_t _sq_size{0};
+        void* _cq_ptr{nullptr};
+        size_t _cq_size{0};
+        io_uring_sqe* _sqes{nullptr};
+        size_t _sqes_size{0};
+        unsigned* _sq_head{nullptr};
+        unsigned* _sq_tail{nullptr};
+        unsigned* _sq_array{nullptr};
+        unsigned _sq_mask{0};
+        unsigned _sq_entries{0};
+        unsigned* _cq_head{nullptr};
+        unsigned* _cq_tail{nullptr};
+        unsigned _cq_mask{0};
+        io_uring_cqe* _cqes{nullptr};
+        /// Our copy of the submission tail, published to the kernel on submit
+        unsigned _local_tail{0};
+        /// Prepared requests the kernel doesn't know about yet
+        unsigned _pending{0};
+        /// Storage for the timeout request used by submit_and_wait, must outlive the request
+        struct { int64_t tv_sec; int64_t tv_nsec; } _timeout{};
+        /// Last batch of completions
+        std::vector<IoUringCompletion> _completed;
+        /// Gets the next free submission entry, flushing to the kernel if the queue is full
+        io_uring_sqe* next_sqe();
+        /// Calls io_uring_enter
+        int enter(unsigned to_submit, unsigned min_complete, bool wait);
+        /// Copies every available completion into _completed
+        void harvest();
+    public:
+        /// user_data reserved for the internal timeout request, never returned as a completion
+        static constexpr uint64_t timeout_user_data = UINT64_MAX;
+        /**
+         * Constructs the ring, call create() after setting the handlers
+         * @param entries submission queue size, rounded up to a power of two by the kernel
+         */
+        explicit IoUring(unsigned entries = 256);
+        ~IoUring();
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        /// A table of every possible create error and callback functions to run
+        HandlerTable<IoUringError, void()> create_handlers;
+        /// Sets up the ring and maps its queues
+        void create();
+        /// Whether create() succeeded
+        bool is_created() const { return _fd != -1; }
+
+        /**
+         * Prepares an accept4(2) on a listening socket, accepted sockets are close-on-exec
+         * @param fd listening socket
+         * @param user_data returned with the completion
+         */
+        void prepare_accept(int fd, uint64_t user_data);
+        /**
+         * Prepares a recv(2)
+         * @param fd socket to receive from
+         * @param buffer where the bytes will land, must stay valid until the completion is harvested
+         * @param length size of buffer
+         * @param user_data returned with the completion
+         */
+        void prepare_recv(int fd, void* buffer, size_t length, uint64_t user_data);
+        /**
+         * Prepares a send(2). SIGPIPE is never raised, a closed peer completes with -EPIPE
+         * @param fd socket to send to
+         * @param buffer bytes to send, must stay valid until the completion is harvested
+         * @param length size of buffer
+         * @param user_data returned with the completion
+         */
+        void prepare_send(int fd, const void* buffer, size_t length, uint64_t user_data);
+        /**
+         * Prepares a one-shot readiness poll, completes with the ready poll(2) events once fd is readable
+         * @param fd any pollable file descriptor (e.g. a ReactorWaker)
+         * @param user_data returned with the completion
+         */
+        void prepare_poll(int fd, uint64_t user_data);
+
+        /// A table of every possible submit error and callback functions to run
+        HandlerTable<IoUringError, void()> submit_handlers;
+        /**
+         * Submits every prepared request and waits for at least one completion
+         * @param timeout_ms milliseconds to wait, -1 waits forever
+         * @return every completion that was available, valid until the next call
+         */
+        const std::vector<IoUringCompletion>& submit_and_wait(int timeout_ms);
+    };
+} // LibSocket
+
+#endif //CLIENTSERVERCHATAPP_IOURING_H
@@ -0,0 +1,162 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#include "OutboundQueue.h"
+#include <algorithm>
+#include <sys/uio.h>
+#if defined(LIBSOCKET_ZEROCOPY)
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#endif
+
+namespace LibSocket {
+    void OutboundQueue::push(SharedFrame frame, bool droppable) {
+        if (frame->empty()) return;
+        _pending_bytes += frame->size();
+        _frames.push_back({std::move(frame), droppable, 0});
+    }
+
+    size_t OutboundQueue::shed(size_t max_bytes, size_t max_frames, bool front_busy, const std::function<SharedFrame(size_t)>& notice) {
+        // dropping a frame that's partly on the wire would put the stream out of step
+        size_t first = front_busy || _offset > 0 ? 1 : 0;
+        size_t dropped = 0;
+        size_t skipped = 0;
+        size_t position = _frames.size();
+        for (size_t i = first; i < _frames.size() && (_pending_bytes > max_bytes || _frames.size() > max_frames);) {
+            auto& entry = _frames[i];
+            if (!entry.droppable) {
+                ++i;
+                continue;
+            }
+            if (entry.skipped == 0) ++dropped;
+            skipped += entry.skipped == 0 ? 1 : entry.skipped;
+            _pending_bytes -= entry.frame->size();
+            _frames.erase(_frames.begin() + (ptrdiff_t)i);
+            position = std::min(position, i);
+        }
+        if (notice && skipped > 0) {
+            // where the oldest dropped frame was
+            auto frame = notice(skipped);
+            _pending_bytes += frame->size();
+            _frames.insert(_frames.begin() + (ptrdiff_t)position, {std::move(frame), true, skipped});
+        }
+        return dropped;
+    }
+
+    bool OutboundQueue::flush(int fd, HandlerTable<SocketSendError, void(std::string_view)>& handlers) {
+        struct iovec iov[max_gather];
+        while (!_frames.empty()) {
+            // every queued frame (up to max_gather) goes out with a single syscall
+            size_t count = 0;
+            size_t bytes = 0;
+            for (auto it = _frames.begin(); it != _frames.end() && count < max_gather; ++it, ++count) {
+                size_t skip = count == 0 ? _offset : 0;
+                iov[count].iov_base = const_cast<char*>(it->frame->data() + skip);
+                iov[count].iov_len = it->frame->size() - skip;
+                bytes += iov[count].iov_len;
+            }
+            struct msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            // SIGPIPE would take the whole server down, a closed peer shows up as PIPE instead
+            int flags = MSG_NOSIGNAL;
+#if defined(LIBSOCKET_ZEROCOPY)
+            bool zerocopy = _zerocopy_threshold != 0 && bytes >= _zerocopy_threshold;
+            if (zerocopy) flags |= MSG_ZEROCOPY;
+#endif
+            auto result = ::sendmsg(fd, &msg, flags);
+            auto err = errno;
+            if (result == -1 && err == EINTR) continue;
+#if defined(LIBSOCKET_ZEROCOPY)
+            // out of memory to pin pages for, copying still works
+            if (result == -1 && zerocopy && err == ENOBUFS) {
+                result = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+                err = errno;
+                zerocopy = false;
+            }
+#endif
+            if (result == -1 && (err == EAGAIN || err == EWOULDBLOCK)) return false;
+            if (result == -1) {
+                // keep the frame alive while the handler looks at it
+                auto frame = _frames.front().frame;
+                clear();
+                handlers.dispatch(true, err, *frame);
+                return false;
+            }
+#if defined(LIBSOCKET_ZEROCOPY)
+            if (zerocopy) {
+                // the kernel reads these pages after sendmsg returns, hold every frame it touched
+                std::vector<SharedFrame> pinned;
+                size_t covered = 0;
+                for (auto it = _frames.begin(); it != _frames.end() && covered < (size_t)result; ++it) {
+                    covered += pinned.empty() ? it->frame->size() - _offset : it->frame->size();
+                    pinned.push_back(it->frame);
+                }
+                _zerocopy_in_flight.emplace_back(_zerocopy_next_id++, std::move(pinned));
+            }
+#endif
+            auto frame = _frames.front().frame;
+            consume(result);
+            handlers.run(SocketSendError::SUCCESS, *frame);
+        }
+        return true;
+    }
+
+    std::pair<const char*, size_t> OutboundQueue::front() const {
+        const auto& frame = _frames.front().frame;
+        return {frame->data() + _offset, frame->size() - _offset};
+    }
+
+    void OutboundQueue::consume(size_t length) {
+        _pending_bytes -= length;
+        _offset += length;
+        while (!_frames.empty() && _offset >= _frames.front().frame->size()) {
+            _offset -= _frames.front().frame->size();
+            _frames.pop_front();
+        }
+    }
+
+    void OutboundQueue::clear() {
+        _frames.clear();
+        _offset = 0;
+        _pending_bytes = 0;
+    }
+
+    bool OutboundQueue::enable_zerocopy(int fd, size_t threshold) {
+#if defined(LIBSOCKET_ZEROCOPY)
+        int one = 1;
+        if (::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof one) == -1) return false;
+        _zerocopy_threshold = threshold == 0 ? 1 : threshold;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void OutboundQueue::reclaim(int fd) {
+#if defined(LIBSOCKET_ZEROCOPY)
+        if (_zerocopy_in_flight.empty()) return;
+        char control[256];
+        while (true) {
+            struct msghdr msg{};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof control;
+            if (::recvmsg(fd, &msg, MSG_ERRQUEUE) == -1) return;
+            for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                bool recverr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                    || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+                if (!recverr) continue;
+                auto err = (const struct sock_extended_err*)CMSG_DATA(cmsg);
+                if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+                // notifications cover the inclusive range of write ids [ee_info, ee_data]
+                uint32_t last = err->ee_data;
+                if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) _zerocopy_copied += last - err->ee_info + 1;
+                while (!_zerocopy_in_flight.empty() && (int32_t)(last - _zerocopy_in_flight.front().first) >= 0) {
+                    _zerocopy_in_flight.pop_front();
+                }
+            }
+        }
+#endif
+    }
+} // LibSocket
@@ -0,0 +1,135 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_OUTBOUNDQUEUE_H
+#define CLIENTSERVERCHATAPP_OUTBOUNDQUEUE_H
+
+#include "Errors.h"
+#include "HandlerTable.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define LIBSOCKET_ZEROCOPY 1
+#endif
+
+namespace LibSocket {
+    /// An encoded frame, immutable so every queue it waits in can point at the same bytes
+    using SharedFrame = std::shared_ptr<const std::string>;
+
+    /**
+     * Frames waiting to be written to one non-blocking socket.
+     * @details Frames are shared and immutable so the same bytes can sit in every recipient's queue.
+     * flush() gathers as many queued frames as fit in one sendmsg and keeps going until the queue is
+     * empty or the kernel buffer is full. It remembers how much of the front frame already went out,
+     * so the next flush (usually on a writable event) resumes there. A slow reader only ever grows
+     * its own queue, it never blocks the thread writing to everyone else.
+     *
+     * A queue can be kept bounded with shed(): frames pushed as droppable (chat broadcasts, say) are dropped
+     * oldest first, optionally replaced by a single notice saying how many were skipped.
+     *
+     * With enable_zerocopy (Linux 4.14+) large writes use MSG_ZEROCOPY: the kernel sends straight from
+     * the frames' memory, so they are kept alive past the write until reclaim() reads the completion
+     * notification off the socket's error queue.
+     */
+    class OutboundQueue {
+    private:
+        struct Entry {
+            SharedFrame frame;
+            /// Whether shed may drop it
+            bool droppable;
+            /// Frames a notice made by shed stands for, 0 for every other frame
+            size_t skipped;
+        };
+        std::deque<Entry> _frames;
+        /// Bytes of the front frame already accepted by the kernel
+        size_t _offset{0};
+        /// Bytes queued across every frame minus _offset
+        size_t _pending_bytes{0};
+        /// Writes of at least this many bytes use MSG_ZEROCOPY, 0 when disabled
+        size_t _zerocopy_threshold{0};
+        /// Id the kernel will give the next successful zerocopy write
+        uint32_t _zerocopy_next_id{0};
+        /// Frames the kernel may still be reading from, by the id of the write that used them
+        std::deque<std::pair<uint32_t, std::vector<SharedFrame>>> _zerocopy_in_flight;
+        /// Zerocopy writes the kernel ended up copying anyway (always the case over loopback)
+        size_t _zerocopy_copied{0};
+    public:
+        /// Most frames gathered into one sendmsg
+        static constexpr size_t max_gather = 64;
+        /**
+         * Adds a frame to the back of the queue
+         * @param frame bytes exactly as they should appear on the wire
+         * @param droppable whether shed may drop the frame to make room, replies that have to arrive shouldn't be
+         */
+        void push(SharedFrame frame, bool droppable = false);
+        /**
+         * Drops droppable frames, oldest first, until the queue is within the limits or nothing droppable is left
+         * @param max_bytes most bytes the queue should hold
+         * @param max_frames most frames the queue should hold
+         * @param front_busy the front frame is being written by someone else (e.g. io_uring) and has to stay,
+         * a front frame flush has started on always stays
+         * @param notice if set, the dropped frames are replaced by the frame it makes from how many were skipped
+         * (a notice from an earlier shed is merged into the new one), the notice itself may go over the limits
+         * @return number of frames dropped, not counting merged notices
+         */
+        size_t shed(size_t max_bytes, size_t max_frames, bool front_busy, const std::function<SharedFrame(size_t skipped)>& notice = {});
+        /**
+         * Writes queued frames until the queue is empty or the socket would block
+         * @param fd non-blocking socket to write to
+         * @param handlers send handlers, errors other than AGAIN/WOULD_BLOCK run with the frame that failed
+         * and drop everything queued since the connection is unusable
+         * @return true if the queue was emptied
+         */
+        bool flush(int fd, HandlerTable<SocketSendError, void(std::string_view)>& handlers);
+        /**
+         * Unsent bytes of the front frame, for callers that hand the write to someone else (e.g. io_uring)
+         * @return pointer to and length of the unsent bytes
+         */
+        std::pair<const char*, size_t> front() const;
+        /// The frame front() points into, keeps it alive while an asynchronous write reads from it
+        const SharedFrame& front_frame() const { return _frames.front().frame; }
+        /**
+         * Marks bytes as written, popping every frame that has been sent completely
+         * @param length bytes the kernel accepted
+         */
+        void consume(size_t length);
+        /// Drops every queued frame
+        void clear();
+        bool empty() const { return _frames.empty(); }
+        /// Number of queued frames
+        size_t size() const { return _frames.size(); }
+        /// Number of bytes still to be written
+        size_t pending_bytes() const { return _pending_bytes; }
+        /// Whether part of the front frame is already written, anything sent now would land in the middle of it
+        bool front_started() const { return _offset != 0; }
+
+        /**
+         * Turns on SO_ZEROCOPY for the socket and sends large writes with MSG_ZEROCOPY from now on
+         * @param fd socket the queue writes to
+         * @param threshold smallest write worth pinning pages for, small writes are cheaper to copy
+         * @return false if the platform or socket doesn't support it, the queue keeps copying
+         */
+        bool enable_zerocopy(int fd, size_t threshold);
+        /**
+         * Reads zerocopy completion notifications off the socket's error queue and releases the frames
+         * of every finished write. Call when the reactor reports an error condition on the socket.
+         * @param fd socket the queue writes to
+         */
+        void reclaim(int fd);
+        /// Zerocopy writes whose frames are still held
+        size_t zerocopy_in_flight() const { return _zerocopy_in_flight.size(); }
+        /// Zerocopy writes the kernel fell back to copying
+        size_t zerocopy_copied() const { return _zerocopy_copied; }
+    };
+} // LibSocket
+
+#endif //CLIENTSERVERCHATAPP_OUTBOUNDQUEUE_H
@@ -0,0 +1,166 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#include "Reactor.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace LibSocket {
+    namespace {
+        bool has(std::initializer_list<ReactorInterest> interest, ReactorInterest flag) {
+            for (auto i : interest) if (i == flag) return true;
+            return false;
+        }
+    }
+
+    Reactor::Reactor(size_t max_events): _native_events(max_events), _ready() {
+        _ready.reserve(max_events);
+    }
+
+    Reactor::~Reactor() {
+        if (_fd != -1) ::close(_fd);
+    }
+
+    void Reactor::create() {
+#if defined(__linux__)
+        _fd = ::epoll_create1(EPOLL_CLOEXEC);
+#else
+        _fd = ::kqueue();
+#endif
+        auto err = errno;
+        create_handlers.dispatch(_fd == -1, err);
+    }
+
+    void Reactor::control(int fd, std::initializer_list<ReactorInterest> interest, bool modify) {
+#if defined(__linux__)
+        struct epoll_event ev{};
+        if (has(interest, ReactorInterest::READ)) ev.events |= EPOLLIN | EPOLLRDHUP;
+        if (has(interest, ReactorInterest::WRITE)) ev.events |= EPOLLOUT;
+        if (has(interest, ReactorInterest::EDGE_TRIGGERED)) ev.events |= EPOLLET;
+        ev.data.fd = fd;
+        auto result = ::epoll_ctl(_fd, modify ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev);
+#else
+        // kqueue keeps one registration per filter, so a modify is an add/delete of each filter
+        unsigned short clear = has(interest, ReactorInterest::EDGE_TRIGGERED) ? EV_CLEAR : 0;
+        struct kevent changes[2];
+        int n = 0;
+        if (has(interest, ReactorInterest::READ)) {
+            EV_SET(&changes[n++], fd, EVFILT_READ, EV_ADD | clear, 0, 0, nullptr);
+        } else if (modify) {
+            EV_SET(&changes[n++], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+        }
+        if (has(interest, ReactorInterest::WRITE)) {
+            EV_SET(&changes[n++], fd, EVFILT_WRITE, EV_ADD | clear, 0, 0, nullptr);
+        } else if (modify) {
+            EV_SET(&changes[n++], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+        }
+        auto result = ::kevent(_fd, changes, n, nullptr, 0, nullptr);
+        // deleting a filter that was never added is not an error worth reporting
+        if (result == -1 && errno == ENOENT && modify) result = 0;
+#endif
+        auto err = errno;
+        control_handlers.dispatch(result == -1, err, fd);
+    }
+
+    void Reactor::add(int fd, std::initializer_list<ReactorInterest> interest) {
+        control(fd, interest, false);
+    }
+
+    void Reactor::modify(int fd, std::initializer_list<ReactorInterest> interest) {
+        control(fd, interest, true);
+    }
+
+    void Reactor::remove(int fd) {
+#if defined(__linux__)
+        auto result = ::epoll_ctl(_fd, EPOLL_CTL_DEL, fd, nullptr);
+#else
+        struct kevent changes[2];
+        EV_SET(&changes[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+        EV_SET(&changes[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+        // one of the filters may not be registered, kevent still applies the other
+        auto result = ::kevent(_fd, changes, 2, nullptr, 0, nullptr);
+        if (result == -1 && errno == ENOENT) result = 0;
+#endif
+        auto err = errno;
+        if (result == -1) control_handlers.dispatch(true, err, fd);
+    }
+
+    const std::vector<ReactorEvent>& Reactor::wait(int timeout_ms) {
+        _ready.clear();
+#if defined(__linux__)
+        auto result = ::epoll_wait(_fd, _native_events.data(), (int)_native_events.size(), timeout_ms);
+#else
+        struct timespec ts{};
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+        auto result = ::kevent(_fd, nullptr, 0, _native_events.data(), (int)_native_events.size(), timeout_ms < 0 ? nullptr : &ts);
+#endif
+        auto err = errno;
+        if (result == -1) {
+            wait_handlers.dispatch(true, err);
+            return _ready;
+        }
+        for (int i = 0; i < result; ++i) {
+            const auto& ev = _native_events[i];
+#if defined(__linux__)
+            _ready.push_back({
+                ev.data.fd,
+                (ev.events & (EPOLLIN | EPOLLRDHUP)) != 0,
+                (ev.events & EPOLLOUT) != 0,
+                (ev.events & (EPOLLHUP | EPOLLERR)) != 0
+            });
+#else
+            _ready.push_back({
+                (int)ev.ident,
+                ev.filter == EVFILT_READ,
+                ev.filter == EVFILT_WRITE,
+                (ev.flags & (EV_EOF | EV_ERROR)) != 0
+            });
+#endif
+        }
+        wait_handlers.run(ReactorError::SUCCESS);
+        return _ready;
+    }
+
+    ReactorWaker::~ReactorWaker() {
+        if (_write_fd != -1 && _write_fd != _read_fd) ::close(_write_fd);
+        if (_read_fd != -1) ::close(_read_fd);
+    }
+
+    void ReactorWaker::create() {
+#if defined(__linux__)
+        _read_fd = _write_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        auto result = _read_fd;
+#else
+        int fds[2];
+        auto result = ::pipe(fds);
+        if (result != -1) {
+            _read_fd = fds[0];
+            _write_fd = fds[1];
+            for (auto fd : fds) {
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+                ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+        }
+#endif
+        auto err = errno;
+        create_handlers.dispatch(result == -1, err);
+    }
+
+    void ReactorWaker::notify() {
+        // a full pipe/saturated counter already means a wakeup is pending, so failures can be ignored
+#if defined(__linux__)
+        uint64_t one = 1;
+        [[maybe_unused]] auto result = ::write(_write_fd, &one, sizeof one);
+#else
+        char one = 1;
+        [[maybe_unused]] auto result = ::write(_write_fd, &one, sizeof one);
+#endif
+    }
+
+    void ReactorWaker::drain() {
+        char buffer[64];
+        while (::read(_read_fd, buffer, sizeof buffer) > 0) {}
+    }
+} // LibSocket
@@ -0,0 +1,150 @@
+//
+// Created by Robert Sale on 10/18/26.
+//
+
+#ifndef CLIENTSERVERCHATAPP_REACTOR_H
+#define CLIENTSERVERCHATAPP_REACTOR_H
+
+#include "Errors.h"
+#include "HandlerTable.h"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <sys/event.h>
+#endif
+
+namespace LibSocket {
+    enum class ReactorInterest : uint32_t {
+        /// Notify when the file descriptor has data to read (or a pending connection for listeners)
+        READ = 1 << 0,
+        /// Notify when the file descriptor can be written to without blocking
+        WRITE = 1 << 1,
+        /**
+         * Only notify when readiness changes instead of for as long as the fd stays ready.
+         * The owner is then responsible for draining the fd until it would block, otherwise
+         * data left in the kernel buffer will not produce another event.
+         */
+        EDGE_TRIGGERED = 1 << 2,
+    };
+
+    /**
+     * A single readiness notification produced by Reactor::wait
+     */
+    struct ReactorEvent {
+        /// The file descriptor the event belongs to
+        int fd;
+        /// Data (or a connection) is available to read
+        bool readable;
+        /// The kernel send buffer has room
+        bool writable;
+        /// Peer hung up or an error is pending on the fd
+        bool hang_up;
+    };
+
+    /**
+     * Readiness notification for many file descriptors at once.
+     * @details Uses epoll on Linux and kqueue everywhere else. File descriptors get registered once
+     * and every call to wait only reports the ones that are actually ready, so the cost of a wakeup
+     * depends on how many sockets have something to say rather than how many are connected.
+     * Unlike select there is no FD_SETSIZE ceiling.
+     */
+    class Reactor {
+    private:
+#if defined(__linux__)
+        using NativeEvent = struct epoll_event;
+#else
+        using NativeEvent = struct kevent;
+#endif
+        /// File descriptor of the epoll/kqueue instance
+        int _fd{-1};
+        /// Buffer the kernel writes ready events into
+        std::vector<NativeEvent> _native_events;
+        /// Platform independent view of the last batch of events
+        std::vector<ReactorEvent> _ready;
+        /// Converts an interest list into the platform flags and applies it
+        void control(int fd, std::initializer_list<ReactorInterest> interest, bool modify);
+    public:
+        /**
+         * Constructs the reactor, call create() after setting the handlers
+         * @param max_events how many events a single wait can report
+         */
+        explicit Reactor(size_t max_events = 256);
+        ~Reactor();
+        Reactor(const Reactor&) = delete;
+        Reactor& operator=(const Reactor&) = delete;
+
+        /// A table of every possible create error and callback functions to run
+        HandlerTable<ReactorError, void()> create_handlers;
+        /// Creates the kernel side of the reactor
+        void create();
+
+        /// A table of every possible registration error and callback functions to run, receives the fd
+        HandlerTable<ReactorError, void(int)> control_handlers;
+        /**
+         * Registers a file descriptor with the reactor
+         * @param fd file descriptor to watch
+         * @param interest see LibSocket::ReactorInterest for details
+         */
+        void add(int fd, std::initializer_list<ReactorInterest> interest);
+        /**
+         * Replaces the interest list of an already registered file descriptor
+         * @param fd file descriptor being watched
+         * @param interest see LibSocket::ReactorInterest for details
+         */
+        void modify(int fd, std::initializer_list<ReactorInterest> interest);
+        /**
+         * Stops watching a file descriptor. Must be called before the fd is closed if it may have been dup'd.
+         * @param fd file descriptor being watched
+         */
+        void remove(int fd);
+
+        /// A table of every possible wait error and callback functions to run
+        HandlerTable<ReactorError, void()> wait_handlers;
+        /**
+         * Blocks until at least one registered file descriptor is ready or the timeout expires
+         * @param timeout_ms milliseconds to wait, -1 waits forever
+         * @return the ready events, valid until the next call to wait
+         */
+        const std::vector<ReactorEvent>& wait(int timeout_ms);
+
+        /**
+         * Gets the reactor's file descriptor
+         * @return file descriptor
+         */
+        int get_fd() const { return _fd; }
+    };
+
+    /**
+     * Lets another thread interrupt a Reactor::wait (or an io_uring poll).
+     * @details Register read_fd() for READ and call drain() whenever it becomes readable. Uses an eventfd
+     * on Linux and a non-blocking pipe everywhere else. Notifications before a drain coalesce into one wakeup.
+     */
+    class ReactorWaker {
+    private:
+        int _read_fd{-1};
+        int _write_fd{-1};
+    public:
+        ReactorWaker() = default;
+        ~ReactorWaker();
+        ReactorWaker(const ReactorWaker&) = delete;
+        ReactorWaker& operator=(const ReactorWaker&) = delete;
+
+        /// A table of every possible create error and callback functions to run
+        HandlerTable<ReactorError, void()> create_handlers;
+        /// Creates the underlying eventfd or pipe
+        void create();
+        /// File descriptor to register with the reactor
+        int read_fd() const { return _read_fd; }
+        /// Wakes up whoever is waiting on read_fd(), safe to call from any thread
+        void notify();
+        /// Resets the waker so the next notify produces a new event
+        void drain();
+    };
+} // LibSocket
+
+#endif //CLIENTSERVERCHATAPP_REACTOR_H
@@ -6,15 +6,27 @@
 #define CLIENTSERVERCHATAPP_SOCKET_H
 
 #include "Errors.h"
+#include "HandlerTable.h"
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <functional>
-#include <map>
 #include <initializer_list>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <regex>
+#include <type_traits>
+#include <utility>
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define LIBSOCKET_ACCEPT4 1
+#endif
 
 namespace LibSocket {
     enum class SocketFamily {
@@ -201,7 +213,9 @@ namespace LibSocket {
      * @details Every method has a error handler map. If you move lambdas
      * into the map they will be executed automatically. Makes code organization
      * a lot more intuitive.
-     * @tparam SizeType integral used to store the size of the message
+     * @details Messages are framed with a LEB128 varint length followed by the payload, so a short chat line
+     * costs a single header byte while large payloads stay possible up to max_message_size.
+     * @tparam SizeType integral the decoded message length is stored in, bounds the largest describable message
      */
     template<typename SizeType>
     class Socket {
@@ -213,25 +227,23 @@ namespace LibSocket {
         SocketFileDescriptor _fd{-1};
         /// If true, will close this socket in the destructor
         bool _auto_close;
+        /// Whether O_NONBLOCK is known to be set on _fd
+        bool _non_blocking{false};
 
         Socket(): _auto_close{true}, _fd{-1} {}
         explicit Socket(bool auto_close): _auto_close{auto_close}, _fd{-1} {}
         ~Socket() { if (_auto_close) close(); }
 
-        /// A map of every possible close error and callback functions to run
-        std::map<SocketCloseError, std::function<void()>> close_handlers;
+        /// A table of every possible close error and callback functions to run
+        HandlerTable<SocketCloseError, void()> close_handlers;
         void close() {
             auto result = ::close(_fd);
             auto err = errno;
-            if (result == -1 && close_handlers.contains((SocketCloseError)err)) {
-                close_handlers[(SocketCloseError)err]();
-            } else if (close_handlers.contains(SocketCloseError::SUCCESS)) {
-                close_handlers[SocketCloseError::SUCCESS]();
-            }
+            close_handlers.dispatch(result == -1, err);
         }
 
-        /// A map of every possible create error and callback functions to run
-        std::map<SocketCreateError, std::function<void()>> create_handlers;
+        /// A table of every possible create error and callback functions to run
+        HandlerTable<SocketCreateError, void()> create_handlers;
         /**
          * Create a new socket and set it internally
          * @param family The socket family used by the new socket (see LibSocket::SocketFamily for details)
@@ -240,15 +252,11 @@ namespace LibSocket {
         void create(SocketFamily family, Type type) {
             _fd = ::socket((int)family, (int)type, 0);
             auto err = errno;
-            if (_fd == -1 && create_handlers.contains((SocketCreateError)err)) {
-                create_handlers[(SocketCreateError)err]();
-            } else if (create_handlers.contains(SocketCreateError::SUCCESS)) {
-                create_handlers[SocketCreateError::SUCCESS]();
-            }
+            create_handlers.dispatch(_fd == -1, err);
         }
 
-        /// A map of every possible receive error and callback functions to run
-        std::map<SocketReceiveError, std::function<void(const std::string&, Socket*)>> receive_handlers;
+        /// A table of every possible receive error and callback functions to run
+        HandlerTable<SocketReceiveError, void(const std::string&, Socket*)> receive_handlers;
         /**
          * Receive a message from the socket
          * @param buffer where the message will be stored
@@ -260,44 +268,205 @@ namespace LibSocket {
             for (auto f : flags) rflags |= (int)f;
             auto result = ::recv(_fd, buffer, length, rflags);
             auto err = errno;
-            if (result == -1 && receive_handlers.contains((SocketReceiveError)err)) {
-                receive_handlers[(SocketReceiveError)err]("", this);
-            } else if (result == 0 && receive_handlers.contains(SocketReceiveError::DISCONNECTING)) {
-                receive_handlers[SocketReceiveError::DISCONNECTING]("", this);
+            if (result == -1) {
+                receive_handlers.dispatch(true, err, "", this);
+            } else if (result == 0) {
+                receive_handlers.run(SocketReceiveError::DISCONNECTING, "", this);
             } else if (receive_handlers.contains(SocketReceiveError::SUCCESS)) {
                 std::string message{(char*) buffer};
-                receive_handlers[SocketReceiveError::SUCCESS](message, this);
+                receive_handlers.run(SocketReceiveError::SUCCESS, message, this);
             }
             return result;
         }
-         /**
-          * Receives a message
-          * @tparam T integral used to determine the size of the message
-          * @param flags see LibSocket::SocketReceiveFlags for more info (defaults to empty list)
-          * @return string result of what was received
-          */
+        /**
+         * Receives the next message. Bytes come in through the same per-socket buffer receive_frames uses,
+         * so one recv can carry several frames (the rest are returned by later calls without touching the
+         * kernel) and a frame split across reads is reassembled instead of lost.
+         * @param flags see LibSocket::SocketReceiveFlags for more info (defaults to empty list)
+         * @return the message, empty on error, disconnect or if a non-blocking socket ran out of data
+         */
         std::string receive_str(std::initializer_list<SocketReceiveFlags> flags) {
-            SizeType size = 0;
             int rflags{0};
             for(auto f: flags) rflags |= (int)f;
-            auto res = ::recv(_fd, &size, sizeof size, rflags);
-            auto err = (SocketReceiveError)errno;
-            if (res == -1 && receive_handlers.contains(err)) {
-                receive_handlers[err]("", this);
-                return "";
-            } else if (res == 0 && receive_handlers.contains(SocketReceiveError::DISCONNECTING)) {
-                receive_handlers[SocketReceiveError::DISCONNECTING]("", this);
-                return "";
+            std::string message;
+            while (!next_frame(message)) {
+                if (_read_rejected) return "";
+                auto [buffer, length] = read_buffer_space();
+                auto res = ::recv(_fd, buffer, length, rflags);
+                auto err = errno;
+                if (res == -1) {
+                    receive_handlers.dispatch(true, err, "", this);
+                    return "";
+                } else if (res == 0) {
+                    receive_handlers.run(SocketReceiveError::DISCONNECTING, "", this);
+                    return "";
+                }
+                _read_buffer_size += res;
+            }
+            receive_handlers.run(SocketReceiveError::SUCCESS, message, this);
+            return message;
+        }
+
+        /// Unsigned version of SizeType, varint lengths are always positive
+        using LengthType = std::make_unsigned_t<SizeType>;
+        /// Most bytes a varint header can take, seven bits of the length per byte
+        static constexpr size_t max_header_size = (sizeof(LengthType) * 8 + 6) / 7;
+        /// Default for max_message_size
+        static constexpr size_t default_max_message_size = std::min<size_t>(4 * 1024 * 1024, std::numeric_limits<LengthType>::max());
+        /// How much room read_buffer_space offers at minimum, one recv can take this many bytes
+        static constexpr size_t read_chunk_size = 4096;
+
+        /**
+         * Largest payload the receive methods will accept. A header announcing more runs the MESSAGE_TOO_LARGE
+         * receive handler before any memory is set aside for the payload, and the rest of the stream is dropped.
+         */
+        size_t max_message_size{default_max_message_size};
+
+        /// Bytes received ahead of time that haven't been handed out as frames yet
+        std::vector<char> _read_buffer;
+        /// Where the first unparsed byte of _read_buffer is, everything before it was already decoded
+        size_t _read_offset{0};
+        /// How much of _read_buffer holds received bytes
+        size_t _read_buffer_size{0};
+        /// Header and payload size of the frame at _read_offset once its header has been validated
+        size_t _read_frame_size{0};
+        /// Set once a frame was rejected, the stream can't be resynchronized after that
+        bool _read_rejected{false};
+
+        /**
+         * Writes the varint header for a message length
+         * @param length payload size
+         * @param out room for at least max_header_size bytes
+         * @return number of header bytes written
+         */
+        static size_t encode_header(size_t length, char* out) {
+            size_t i = 0;
+            do {
+                char byte = (char)(length & 0x7f);
+                length >>= 7;
+                out[i++] = length != 0 ? (char)(byte | 0x80) : byte;
+            } while (length != 0);
+            return i;
+        }
+
+        /**
+         * Reads a varint header
+         * @param data received bytes
+         * @param available how many bytes data holds
+         * @param length receives the payload size
+         * @return number of header bytes, 0 if more bytes are needed, -1 if it can't be a valid header
+         */
+        static ssize_t decode_header(const char* data, size_t available, size_t& length) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < std::min(available, max_header_size); ++i) {
+                auto byte = (unsigned char)data[i];
+                value |= (uint64_t)(byte & 0x7f) << (7 * i);
+                if ((byte & 0x80) == 0) {
+                    if (value > std::numeric_limits<LengthType>::max()) return -1;
+                    length = (size_t)value;
+                    return (ssize_t)i + 1;
+                }
+            }
+            return available >= max_header_size ? -1 : 0;
+        }
+
+        /**
+         * Decodes the frame at the front of the read buffer. Zero length frames are heartbeats, they run the
+         * HEARTBEAT receive handler and are skipped otherwise, which also keeps peers that still send a null
+         * terminator after every message working.
+         * @param message receives the payload of the frame
+         * @return false if the buffer doesn't hold a complete frame yet
+         */
+        bool next_frame(std::string& message) {
+            while (!_read_rejected && _read_buffer_size > _read_offset) {
+                size_t length;
+                auto header = decode_header(_read_buffer.data() + _read_offset, _read_buffer_size - _read_offset, length);
+                if (header == 0) return false;
+                // checked before the buffer is grown to fit the payload
+                if (header == -1 || length > max_message_size) {
+                    _read_rejected = true;
+                    _read_offset = _read_buffer_size = _read_frame_size = 0;
+                    _read_buffer = {};
+                    receive_handlers.run(SocketReceiveError::MESSAGE_TOO_LARGE, "", this);
+                    return false;
+                }
+                _read_frame_size = header + length;
+                // wait for the rest of the frame
+                if (_read_buffer_size - _read_offset < _read_frame_size) return false;
+                _read_offset += _read_frame_size;
+                _read_frame_size = 0;
+                if (length == 0) {
+                    receive_handlers.run(SocketReceiveError::HEARTBEAT, "", this);
+                    continue;
+                }
+                message.assign(_read_buffer.data() + _read_offset - length, length);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * Free space at the end of the read buffer for a receive to land in. Decoded bytes are only
+         * moved out of the way when the space runs low. The buffer grows to fit a frame whose header
+         * was already validated, otherwise only by read_chunk_size.
+         * @return pointer to and length of the free space
+         */
+        std::pair<char*, size_t> read_buffer_space() {
+            // nothing after a rejected frame is ever decoded, keep reusing the same chunk
+            if (_read_offset == _read_buffer_size || _read_rejected) {
+                _read_offset = _read_buffer_size = 0;
+            }
+            size_t buffered = _read_buffer_size - _read_offset;
+            size_t wanted = std::max(read_chunk_size, _read_frame_size > buffered ? _read_frame_size - buffered : 0);
+            if (_read_buffer.size() - _read_buffer_size < wanted && _read_offset > 0) {
+                // move the leftover partial frame to the front for the next receive to append to
+                memmove(_read_buffer.data(), _read_buffer.data() + _read_offset, buffered);
+                _read_buffer_size = buffered;
+                _read_offset = 0;
+            }
+            if (_read_buffer.size() - _read_buffer_size < wanted) {
+                _read_buffer.resize(_read_buffer_size + wanted);
+            }
+            return {_read_buffer.data() + _read_buffer_size, _read_buffer.size() - _read_buffer_size};
+        }
+
+        /**
+         * Accepts bytes that were written into read_buffer_space() and runs the SUCCESS receive handler
+         * for every complete frame. A partial frame at the end stays buffered until the rest arrives.
+         * @param length how many bytes were received
+         */
+        void receive_buffered(size_t length) {
+            _read_buffer_size += length;
+            std::string message;
+            while (next_frame(message)) {
+                receive_handlers.run(SocketReceiveError::SUCCESS, message, this);
+            }
+        }
+
+        /**
+         * Makes one recv into the read buffer and runs the SUCCESS receive handler for every frame it completed.
+         * Safe on non-blocking sockets, a frame split across reads waits in the buffer for the rest.
+         * @param flags see LibSocket::SocketReceiveFlags for more info (defaults to empty list)
+         * @return result of recv, keep calling while it's positive to drain an edge-triggered socket
+         */
+        ssize_t receive_frames(std::initializer_list<SocketReceiveFlags> flags) {
+            int rflags = 0;
+            for (auto f : flags) rflags |= (int)f;
+            auto [buffer, length] = read_buffer_space();
+            auto result = ::recv(_fd, buffer, length, rflags);
+            auto err = errno;
+            if (result == -1) {
+                receive_handlers.dispatch(true, err, "", this);
+            } else if (result == 0) {
+                receive_handlers.run(SocketReceiveError::DISCONNECTING, "", this);
+            } else {
+                receive_buffered(result);
             }
-            if (res == 1 && size == 0) return "";
-            char buff[size + 1];
-            memset(buff, 0, size + 1);
-            this->receive(buff, size, flags);
-            return {buff};
+            return result;
         }
 
-        /// A map of every possible send error and callback functions to run
-        std::map<SocketSendError, std::function<void(const std::string&)>> send_handlers;
+        /// A table of every possible send error and callback functions to run
+        HandlerTable<SocketSendError, void(std::string_view)> send_handlers;
         /**
          * Sends a message using the stored file descriptor
          * @param buf pointer to bytes
@@ -310,12 +479,7 @@ namespace LibSocket {
             for (auto f : flags) sflags |= (int)f;
             auto result = ::send(_fd, buf, len, sflags);
             auto err = errno;
-            std::string payload = (char*) buf;
-            if (result == -1 && send_handlers.contains((SocketSendError)err)) {
-                send_handlers[(SocketSendError)err](payload);
-            } else if (send_handlers.contains(SocketSendError::SUCCESS)) {
-                send_handlers[SocketSendError::SUCCESS](payload);
-            }
+            send_handlers.dispatch(result == -1, err, std::string_view{(const char*)buf, len});
         }
 
         /**
@@ -323,29 +487,81 @@ namespace LibSocket {
          * @param message
          * @param flags
          */
-        void full_send(std::string message, std::initializer_list<SocketSendFlags> flags) {
-            char buff[message.size() + sizeof(SizeType) + 1];
-            memset(buff, 0, message.size() + sizeof(SizeType) + 1);
-            SizeType size = (SizeType)message.size();
-            if (size == 0) return;
+        void full_send(const std::string& message, std::initializer_list<SocketSendFlags> flags) {
+            if (message.empty()) return;
+            send_message(message, flags, false);
+        }
 
-            memcpy(buff, &size, sizeof size);
-            strcpy(buff+sizeof(SizeType), message.c_str());
-            send(buff, message.size() + sizeof(SizeType) + 1, flags);
+        /**
+         * Sends an empty frame. It carries no message, the peer runs its HEARTBEAT receive handler instead.
+         * @param flags see SocketSendFlags for more information
+         */
+        void send_heartbeat(std::initializer_list<SocketSendFlags> flags) {
+            send_message(std::string{}, flags, false);
         }
 
+        /**
+         * Builds the exact bytes full_send puts on the wire for a message
+         * @param message payload
+         * @return varint size followed by the payload
+         */
+        static std::string encode(const std::string& message) {
+            char header[max_header_size];
+            auto header_size = encode_header(message.size(), header);
+            std::string frame;
+            frame.reserve(header_size + message.size());
+            frame.append(header, header_size);
+            frame += message;
+            return frame;
+        }
 
         /**
-         * Sends a message using a partial message loop. Dynamically sizes the first message based on SizeType.
-         * Errors are automatically handled by send().
-         * @tparam T integral for storing the size of the message
+         * Sends a message using a partial message loop. Header and payload are gathered into each sendmsg and
+         * a short write continues from the first unsent byte until the whole frame is out or an error occurs.
          * @param message string being sent
          * @param flags see SocketSendFlags for more information
          */
-        void partial_send(std::string message, std::initializer_list<SocketSendFlags> flags) {
-            SizeType size = (SizeType)message.size();
-            send(&size, sizeof(SizeType), flags);
-            send(message.c_str(), message.size(), flags);
+        void partial_send(const std::string& message, std::initializer_list<SocketSendFlags> flags) {
+            send_message(message, flags, true);
+        }
+
+        /**
+         * Sends the header and the payload straight from where they live with one sendmsg, nothing is copied
+         * into a frame first. Runs the send handlers with the payload.
+         * @param message payload
+         * @param flags see SocketSendFlags for more information
+         * @param until_done keep sending after a short write
+         */
+        void send_message(const std::string& message, std::initializer_list<SocketSendFlags> flags, bool until_done) {
+            int sflags = 0;
+            for (auto f : flags) sflags |= (int)f;
+            char header[max_header_size];
+            struct iovec iov[2] = {
+                {header, encode_header(message.size(), header)},
+                {const_cast<char*>(message.data()), message.size()}
+            };
+            struct msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = 2;
+            ssize_t result;
+            int err;
+            do {
+                result = ::sendmsg(_fd, &msg, sflags);
+                err = errno;
+                if (result == -1 && err == EINTR) continue;
+                if (result == -1 || !until_done) break;
+                // drop whatever went out from the front of the vector
+                while (msg.msg_iovlen > 0 && (size_t)result >= msg.msg_iov->iov_len) {
+                    result -= (ssize_t)msg.msg_iov->iov_len;
+                    ++msg.msg_iov;
+                    --msg.msg_iovlen;
+                }
+                if (msg.msg_iovlen > 0) {
+                    msg.msg_iov->iov_base = (char*)msg.msg_iov->iov_base + result;
+                    msg.msg_iov->iov_len -= result;
+                }
+            } while (msg.msg_iovlen > 0);
+            send_handlers.dispatch(result == -1, err, message);
         }
 
         /**
@@ -360,6 +576,26 @@ namespace LibSocket {
          */
         const SocketFileDescriptor& get_fd() {return _fd;}
 
+        /// A table of every possible fcntl error and callback functions to run
+        HandlerTable<SocketFcntlError, void()> fcntl_handlers;
+        /**
+         * Switches the socket between blocking and non-blocking mode (O_NONBLOCK).
+         * Non-blocking sends and receives fail with AGAIN instead of waiting.
+         * @param non_blocking true to stop blocking
+         */
+        void set_non_blocking(bool non_blocking) {
+            auto result = ::fcntl(_fd, F_GETFL);
+            if (result != -1) {
+                result = ::fcntl(_fd, F_SETFL, non_blocking ? result | O_NONBLOCK : result & ~O_NONBLOCK);
+            }
+            auto err = errno;
+            if (result != -1) _non_blocking = non_blocking;
+            fcntl_handlers.dispatch(result == -1, err);
+        }
+
+        /// Whether the socket is in non-blocking mode
+        bool is_non_blocking() const { return _non_blocking; }
+
         /**
          * Checks if _fd is set on the file descriptor set
          * @param fds the file descriptor set
@@ -411,8 +647,8 @@ namespace LibSocket {
         ServerSocket(): Socket{true}, _max_users{10}, _read_fds{} {}
         explicit ServerSocket(size_t max_users): Socket{true}, _max_users{max_users}, _read_fds{} {}
         explicit ServerSocket(bool auto_close): Socket{auto_close}, _max_users{10}, _read_fds{} {}
-        /// A map of every possible accept error and callback functions to run
-        std::map<SocketAcceptError, std::function<void(std::shared_ptr<Socket>)>> accept_handlers;
+        /// A table of every possible accept error and callback functions to run
+        HandlerTable<SocketAcceptError, void(std::shared_ptr<Socket>)> accept_handlers;
         /**
          * Extracts the first connection on the queue of pending connections and creates a socket
          * @param address optional address
@@ -421,18 +657,61 @@ namespace LibSocket {
         void accept(struct sockaddr* address, socklen_t* len) {
             auto result = ::accept(this->_fd, address, len);
             auto err = errno;
-            if (result == -1 && accept_handlers.contains((SocketAcceptError)err)) {
-                accept_handlers[(SocketAcceptError)err](nullptr);
-                return;
+            if (result == -1) {
+                accept_handlers.dispatch(true, err, nullptr);
             } else if (accept_handlers.contains(SocketAcceptError::SUCCESS)) {
                 std::shared_ptr<Socket> client = std::make_shared<Socket>();
                 client->_fd = result;
-                accept_handlers[SocketAcceptError::SUCCESS](client);
+                accept_handlers.run(SocketAcceptError::SUCCESS, client);
             }
         }
 
-        /// A map of every possible bind error and callback functions to run
-        std::map<SocketBindError, std::function<void()>> bind_handlers;
+        /// Most connections accept_pending takes in one call, so a storm can't starve established clients
+        static constexpr size_t max_accept_batch = 64;
+        /**
+         * Accepts every pending connection until the queue is empty (AGAIN) or limit is reached.
+         * @details The listening socket has to be non-blocking. Clients come back non-blocking and close-on-exec,
+         * with accept4 that's a single syscall per connection. AGAIN/WOULD_BLOCK end the batch without running a
+         * handler. ABORTED and PROTOCOL only concern the one connection, their handlers run and the loop moves
+         * on. Any other error runs its handler and stops, e.g. OPEN_FD_LIMIT would fail again right away.
+         * @param limit most connections to accept
+         * @return number of connections accepted
+         */
+        size_t accept_pending(size_t limit = max_accept_batch) {
+            size_t accepted = 0;
+            while (accepted < limit) {
+#if defined(LIBSOCKET_ACCEPT4)
+                auto result = ::accept4(this->_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                auto err = errno;
+#else
+                auto result = ::accept(this->_fd, nullptr, nullptr);
+                auto err = errno;
+#endif
+                if (result == -1 && err == EINTR) continue;
+                if (result == -1 && (err == EAGAIN || err == EWOULDBLOCK)) break;
+                if (result == -1) {
+                    accept_handlers.dispatch(true, err, nullptr);
+                    if (err == ECONNABORTED || err == EPROTO) continue;
+                    break;
+                }
+                ++accepted;
+                std::shared_ptr<Socket> client = std::make_shared<Socket>();
+                client->_fd = result;
+#if defined(LIBSOCKET_ACCEPT4)
+                client->_non_blocking = true;
+#else
+                // no accept4, the flags take their own syscalls. If they fail the caller can still set_non_blocking
+                auto flags = ::fcntl(result, F_GETFL);
+                client->_non_blocking = flags != -1 && ::fcntl(result, F_SETFL, flags | O_NONBLOCK) != -1;
+                ::fcntl(result, F_SETFD, FD_CLOEXEC);
+#endif
+                accept_handlers.run(SocketAcceptError::SUCCESS, client);
+            }
+            return accepted;
+        }
+
+        /// A table of every possible bind error and callback functions to run
+        HandlerTable<SocketBindError, void()> bind_handlers;
         /**
          * Binds socket to a new listening address
          * @param address address to bind
@@ -441,11 +720,7 @@ namespace LibSocket {
         void bind(const struct sockaddr* address, socklen_t address_len) {
             auto result = ::bind(this->_fd, address, address_len);
             auto err = errno;
-            if (result == -1 && bind_handlers.contains((SocketBindError)err)) {
-                bind_handlers[(SocketBindError)err]();
-            } else if (bind_handlers.contains(SocketBindError::SUCCESS)) {
-                bind_handlers[SocketBindError::SUCCESS]();
-            }
+            bind_handlers.dispatch(result == -1, err);
         }
 
         /**
@@ -494,30 +769,26 @@ namespace LibSocket {
             }
             this->bind((struct sockaddr*)&out, sizeof out);
         }
-        /// A map of every possible listen error and callback functions to run
-        std::map<SocketListenError, std::function<void()>> listen_handlers;
+        /// A table of every possible listen error and callback functions to run
+        HandlerTable<SocketListenError, void()> listen_handlers;
+        /**
+         * Marks the socket as listening. The backlog is SOMAXCONN rather than the user limit so a reconnect storm
+         * queues up in the kernel instead of being refused, connections over the limit are turned away after accept.
+         */
         void listen() {
-            auto result = ::listen(this->_fd, _max_users);
-            auto err = (SocketListenError)errno;
-            if (result == -1 && listen_handlers.contains(err)) {
-                listen_handlers[err]();
-            } else if (listen_handlers.contains(SocketListenError::SUCCESS)) {
-                listen_handlers[SocketListenError::SUCCESS]();
-            }
+            auto result = ::listen(this->_fd, SOMAXCONN);
+            auto err = errno;
+            listen_handlers.dispatch(result == -1, err);
         }
 
         void select(int max_sd, struct timeval* timeout) {
             auto result = ::select(max_sd + 1, &_read_fds, nullptr, nullptr, timeout);
             auto err = errno;
-            if (result == -1 && select_handlers.contains((SocketSelectError)err)) {
-                select_handlers[(SocketSelectError)err]();
-            } else if (select_handlers.contains(SocketSelectError::SUCCESS)) {
-                select_handlers[SocketSelectError::SUCCESS]();
-            }
+            select_handlers.dispatch(result == -1, err);
         }
 
-        /// A map of every possible bind error and callback functions to run
-        std::map<SocketSelectError, std::function<void()>> select_handlers;
+        /// A table of every possible bind error and callback functions to run
+        HandlerTable<SocketSelectError, void()> select_handlers;
 
     };
     template<typename SizeType>
@@ -527,8 +798,8 @@ namespace LibSocket {
     public:
         ClientSocket(): Socket{true} {}
         explicit ClientSocket(bool auto_close): Socket{auto_close} {}
-        /// A map of every possible connect error and callback functions to run
-        std::map<SocketConnectError, std::function<void()>> connect_handlers;
+        /// A table of every possible connect error and callback functions to run
+        HandlerTable<SocketConnectError, void()> connect_handlers;
         /**
          * Connects socket to address (connection-mode sockets only)
          * @param address the address struct
@@ -537,11 +808,7 @@ namespace LibSocket {
         void connect(const struct sockaddr* address, socklen_t address_len) {
             auto result = ::connect(this->_fd, address, address_len);
             auto err = errno;
-            if (result == -1 && connect_handlers.contains((SocketConnectError)err)) {
-                connect_handlers[(SocketConnectError)err]();
-            } else if (connect_handlers.contains(SocketConnectError::SUCCESS)) {
-                connect_handlers[SocketConnectError::SUCCESS]();
-            }
+            connect_handlers.dispatch(result == -1, err);
         }
 
         /**
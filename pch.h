@@ -6,12 +6,18 @@
 #include "DeferExec.h"
 #include "RingBuffer.h"
 #include "libsocket/Errors.h"
+#include "libsocket/IoUring.h"
+#include "libsocket/OutboundQueue.h"
+#include "libsocket/Reactor.h"
 #include "libsocket/Socket.h"
 #include <algorithm>
 #include <atomic>
+#include <charconv>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <functional>
 #include <future>
 #include <initializer_list>
@@ -29,6 +35,7 @@
 #include <termios.h>
 #include <thread>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 // unix includes
@@ -52,25 +59,24 @@ using UniqueLock = std::unique_lock<std::mutex>;
 using SocketFileDescriptor = int;
 
 /**
- * Data type of the Socket size. This determines how large the initial message size part of the message will be.
+ * Data type the Socket message size is decoded into. Sizes travel as a varint so this only bounds the
+ * largest message that can be described, a short message still has a one byte header.
  */
-using SocketSizeType = char;
+using SocketSizeType = uint32_t;
 
 /**
- * Evaluates to how large the buffer will be for messages. This is dynamically evaluated at compile time based
- * on the SocketSizeType and allows for flexibility.
- * @return maximum size of message including first bytes describing actual size of payload
+ * Largest message the client and server accept unless configured otherwise (the server has --max-message-size).
+ * Frames announcing more are rejected before any memory is set aside for them.
+ * @return maximum size of a message payload in bytes
  */
 constexpr size_t SocketMaxMessageSize() {
-    size_t size = sizeof(SocketSizeType);
-    for (size_t i = 1; i <= sizeof(SocketSizeType) * 8; ++i) {
-        size *= 2;
-    }
-    return size;
+    return LibSocket::Socket<SocketSizeType>::default_max_message_size;
 }
 
-using MessageSignalType = std::string;
-namespace MessageSignals {
-    constexpr MessageSignalType SRV_FULL() {return "SRV_FULL KbpEWst/j5gpYunQfUZ1Ez1GcaR+n0J8nCEkUNWU/AafOR8QhrV6nu0wf3EGSA+HnRRVbFaDrAfMlmyD46RmMQ==";}
-    constexpr MessageSignalType SRV_DONE_SEND() {return "SRV_DONE_SEND qnedR/eVlWUS/Q7t1WvNP5L9X5nInEi008+w1taykxb2Rcej53Fg/Nc0AlXS1/j1h1/gVaKhBnjF1wKy9X4LKg==";}
+/**
+ * Size of the console's line editing buffer, independent of the message limit so it stays small.
+ * @return longest line the user can type plus the null terminator
+ */
+constexpr size_t ConsoleInputBufferSize() {
+    return 4096;
 }
@@ -3,16 +3,172 @@
 //
 
 #include "Console.h"
-#include "Commands.h"
 #include "Server.h"
 #include "Logger.h"
+#include <getopt.h>
 
 void disable_echo(struct termios* orig);
 
 int main(int argc, char** argv) {
     std::string ip{"127.0.0.1"};
+    auto backend = ClientServerChatApp::IOBackend::REACTOR;
+    size_t threads = 1;
+    size_t max_message_size = ClientServerChatApp::Server::max_inbound_message_size;
+    bool zerocopy = false;
+    std::optional<std::chrono::seconds> idle_timeout, send_timeout;
+    std::optional<size_t> max_queue_bytes, max_queue_frames;
+    std::optional<ClientServerChatApp::SlowClientPolicy> slow_clients;
+    size_t workers = 2;
+    std::optional<size_t> history;
+    std::optional<size_t> max_jobs;
+    const struct option long_options[] = {
+        {"io-uring", no_argument, nullptr, 'u'},
+        {"threads", required_argument, nullptr, 't'},
+        {"max-message-size", required_argument, nullptr, 'm'},
+        {"zerocopy", no_argument, nullptr, 'z'},
+        {"idle-timeout", required_argument, nullptr, 'i'},
+        {"send-timeout", required_argument, nullptr, 's'},
+        {"max-queue-bytes", required_argument, nullptr, 'b'},
+        {"max-queue-frames", required_argument, nullptr, 'f'},
+        {"slow-clients", required_argument, nullptr, 'p'},
+        {"workers", required_argument, nullptr, 'w'},
+        {"max-jobs", required_argument, nullptr, 'j'},
+        {"log-sync", required_argument, nullptr, 'l'},
+        {"store", required_argument, nullptr, 'd'},
+        {"segment-size", required_argument, nullptr, 'g'},
+        {"history", required_argument, nullptr, 'y'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ut:m:zi:s:b:f:p:w:j:l:d:g:y:", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'u': backend = ClientServerChatApp::IOBackend::IO_URING; break;
+            case 'z': zerocopy = true; break;
+            case 't': {
+                if (!std::regex_match(optarg, std::regex{"[1-9][0-9]{0,2}"})) {
+                    std::cout << "--threads expects a number between 1 and 999" << std::endl;
+                    return 1;
+                }
+                threads = std::stoul(optarg);
+                break;
+            }
+            case 'm': {
+                // clients accept SocketMaxMessageSize(), the limit leaves room for the name a relayed chat gains
+                if (!std::regex_match(optarg, std::regex{"[1-9][0-9]{0,9}"}) || std::stoull(optarg) > ClientServerChatApp::Server::max_inbound_message_size) {
+                    std::cout << "--max-message-size expects a number of bytes between 1 and " << ClientServerChatApp::Server::max_inbound_message_size << std::endl;
+                    return 1;
+                }
+                max_message_size = std::stoull(optarg);
+                break;
+            }
+            case 'i':
+            case 's': {
+                if (!std::regex_match(optarg, std::regex{"[0-9]{1,6}"})) {
+                    std::cout << (opt == 'i' ? "--idle-timeout" : "--send-timeout") << " expects a number of seconds (0 disables it)" << std::endl;
+                    return 1;
+                }
+                (opt == 'i' ? idle_timeout : send_timeout) = std::chrono::seconds{std::stoul(optarg)};
+                break;
+            }
+            case 'b':
+            case 'f': {
+                if (!std::regex_match(optarg, std::regex{"[1-9][0-9]{0,11}"})) {
+                    std::cout << (opt == 'b' ? "--max-queue-bytes" : "--max-queue-frames") << " expects a positive number" << std::endl;
+                    return 1;
+                }
+                (opt == 'b' ? max_queue_bytes : max_queue_frames) = std::stoull(optarg);
+                break;
+            }
+            case 'p': {
+                std::string policy{optarg};
+                if (policy == "drop") slow_clients = ClientServerChatApp::SlowClientPolicy::DROP_OLDEST;
+                else if (policy == "coalesce") slow_clients = ClientServerChatApp::SlowClientPolicy::COALESCE;
+                else if (policy == "disconnect") slow_clients = ClientServerChatApp::SlowClientPolicy::DISCONNECT;
+                else {
+                    std::cout << "--slow-clients expects drop, coalesce or disconnect" << std::endl;
+                    return 1;
+                }
+                break;
+            }
+            case 'w':
+            case 'j': {
+                if (!std::regex_match(optarg, std::regex{"[1-9][0-9]{0,2}"})) {
+                    std::cout << (opt == 'w' ? "--workers" : "--max-jobs") << " expects a number between 1 and 999" << std::endl;
+                    return 1;
+                }
+                if (opt == 'w') workers = std::stoul(optarg);
+                else max_jobs = std::stoul(optarg);
+                break;
+            }
+            case 'l': {
+                std::cmatch match;
+                if (std::string_view{optarg} == "none") Utilities::logger_sync.mode = Utilities::LogSync::NONE;
+                else if (std::regex_match(optarg, match, std::regex{"interval:([1-9][0-9]{0,6})"})) {
+                    Utilities::logger_sync.mode = Utilities::LogSync::INTERVAL;
+                    Utilities::logger_sync.interval = std::chrono::milliseconds{std::stoul(match[1])};
+                } else if (std::regex_match(optarg, match, std::regex{"bytes:([1-9][0-9]{0,11})"})) {
+                    Utilities::logger_sync.mode = Utilities::LogSync::BYTES;
+                    Utilities::logger_sync.bytes = std::stoull(match[1]);
+                } else {
+                    std::cout << "--log-sync expects none, interval:MILLISECONDS or bytes:BYTES" << std::endl;
+                    return 1;
+                }
+                break;
+            }
+            case 'd': {
+                if (std::string_view{optarg} == "none") Utilities::logger_store = false;
+                else Utilities::logger_store_path = optarg;
+                break;
+            }
+            case 'g': {
+                // anything smaller would be a file for every handful of messages
+                if (!std::regex_match(optarg, std::regex{"[1-9][0-9]{3,11}"})) {
+                    std::cout << "--segment-size expects a number of bytes, at least 1000" << std::endl;
+                    return 1;
+                }
+                Utilities::logger_segment_bytes = std::stoull(optarg);
+                break;
+            }
+            case 'y': {
+                if (!std::regex_match(optarg, std::regex{"[0-9]{1,5}"})) {
+                    std::cout << "--history expects a number of messages (0 disables it)" << std::endl;
+                    return 1;
+                }
+                history = std::stoul(optarg);
+                break;
+            }
+            default: return 1;
+        }
+    }
+    // shift the positional arguments down so argv[1] is the port no matter how many options were given
+    argc -= optind - 1;
+    argv += optind - 1;
     if (argc < 2) {
-        std::cout << "Usage: server <port number> [ip address] [log file]\n"
+        std::cout << "Usage: server [options] <port number> [ip address] [log file]\n"
+                     "\tOptions:\n"
+                     "\t\t--io-uring    batch socket I/O through io_uring (Linux 5.6+)\n"
+                     "\t\t--threads N   run N event loops sharing the port (default 1)\n"
+                     "\t\t--max-message-size BYTES\n"
+                     "\t\t              disconnect clients that send larger messages (default " << ClientServerChatApp::Server::max_inbound_message_size << ")\n"
+                     "\t\t--zerocopy    send large messages with MSG_ZEROCOPY (Linux 4.14+)\n"
+                     "\t\t--idle-timeout SECONDS\n"
+                     "\t\t              disconnect clients that don't answer heartbeats for this long, 0 disables (default 45)\n"
+                     "\t\t--send-timeout SECONDS\n"
+                     "\t\t              disconnect clients that stop reading for this long, 0 disables (default 30)\n"
+                     "\t\t--max-queue-bytes BYTES, --max-queue-frames N\n"
+                     "\t\t              most that can wait to be sent to one client (default 8388608 bytes, 4096 frames)\n"
+                     "\t\t--slow-clients drop|coalesce|disconnect\n"
+                     "\t\t              what to do when a client's queue is full: drop its oldest chat messages,\n"
+                     "\t\t              replace them with a \"N messages skipped\" notice (default) or disconnect it\n"
+                     "\t\t--workers N   threads answering $getlog and $getlist off the event loops (default 2)\n"
+                     "\t\t--max-jobs N  most $getlog/$getlist answered at once, one per client (default 16)\n"
+                     "\t\t--log-sync none|interval:MILLISECONDS|bytes:BYTES\n"
+                     "\t\t              when the log is fsync'd: never (default), that long after a write, or every so many bytes\n"
+                     "\t\t--store DIR|none\n"
+                     "\t\t              where messages are kept with their sender and time (default next to the log file)\n"
+                     "\t\t--segment-size BYTES\n"
+                     "\t\t              size the store's files roll at (default 67108864)\n"
+                     "\t\t--history N   last messages a client is sent when it registers, 0 disables (default 64)\n"
                      "\tExamples:\n"
                      "\t\tserver 33420\n"
                      "\t\tserver 33420 127.0.0.1\n"
@@ -20,15 +176,15 @@ int main(int argc, char** argv) {
         return 0;
     }
     if (!std::regex_match(argv[1], LibSocket::port_regex)) {
-        std::cout << "Usage: server <port number> [ip address] [log file]\n"
-                     "              ^^^^^^^^^^^^^\n"
+        std::cout << "Usage: server [options] <port number> [ip address] [log file]\n"
+                     "                        ^^^^^^^^^^^^^\n"
                      "The port you entered was invalid. Please try again.";
         return 1;
     }
     if (argc > 2) {
         if (!std::regex_match(std::string{argv[2]}, LibSocket::ipv4_regex)) {
-            std::cout << "Usage: server <port number> [ip address] [log file]\n"
-                         "                            ^^^^^^^^^^^^\n"
+            std::cout << "Usage: server [options] <port number> [ip address] [log file]\n"
+                         "                                      ^^^^^^^^^^^^\n"
                          "The IP you entered was invalid. Please try again.";
             return 1;
         }
@@ -43,13 +199,31 @@ int main(int argc, char** argv) {
     std::string port{argv[1]};
     SmartConsole::Clear(std::cout);
     SmartConsole::Console console{"$exit"};
-    ClientServerChatApp::Server server(&console);
+    ClientServerChatApp::ServerShards shards(&console, threads, workers);
+    if (max_jobs) shards.max_jobs = *max_jobs;
+    for (const auto& server : shards.servers) {
+        server->backend = backend;
+        server->max_message_size = max_message_size;
+        server->zerocopy = zerocopy;
+        if (idle_timeout) server->idle_timeout = *idle_timeout;
+        if (send_timeout) server->send_timeout = *send_timeout;
+        if (max_queue_bytes) server->max_outbound_bytes = *max_queue_bytes;
+        if (max_queue_frames) server->max_outbound_frames = *max_queue_frames;
+        if (slow_clients) server->slow_client_policy = *slow_clients;
+        if (history) server->history_size = *history;
+    }
     console.messages.emplace_back("Welcome to Chat App server!");
     std::thread renderer = console.initialize_renderer();
     std::thread input_capturer = console.initialize_input_capture();
-    std::thread server_thread = server.initialize_server(port, ip);
+    std::vector<std::thread> server_threads = shards.initialize_servers(port, ip);
     while (!console.shutdown.load()) std::this_thread::sleep_for(std::chrono::seconds(2));
-    server_thread.join();
+    for (auto& server_thread : server_threads) server_thread.join();
+    const auto& slow = shards.slow_clients;
+    if (slow.dropped + slow.coalesced + slow.disconnected > 0) {
+        Utilities::log("[INFO]: Full client queues: " + std::to_string(slow.dropped) + " dropped oldest, "
+            + std::to_string(slow.coalesced) + " coalesced (" + std::to_string(slow.frames_dropped) + " messages skipped), "
+            + std::to_string(slow.disconnected) + " disconnected");
+    }
     input_capturer.join();
     renderer.join();
     return 0;